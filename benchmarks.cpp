@@ -0,0 +1,259 @@
+#include "benchmarks.hpp"
+
+void memory_footprint_report() {
+    const size_t job_count = 1000000;
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<double> speedup(0.0, 1.0);
+
+    std::cout << "---- RCGREEDY memory footprint per " << job_count << " jobs ----\n";
+    for (size_t depth : {1, 5, 10}) {
+        RCGREEDY rcg(1000, depth, 1.0, true);
+        size_t empty_bytes = rcg.memory_footprint();
+
+        // reserving sizes every per-job structure for the full population
+        rcg.reserve(job_count);
+        size_t bytes = rcg.memory_footprint();
+        std::cout << "depth " << std::setw(2) << depth
+                  << ": " << std::fixed << std::setprecision(1) << bytes / 1048576.0 << " MiB total, "
+                  << static_cast<double>(bytes - empty_bytes) / job_count << " bytes/job";
+
+        // at depth 10 also add a tenth of the jobs, to check nothing grows past the reservation.
+        // every add reports its whole leaf in the history, so filling shallow trees is quadratic
+        if (depth == 10) {
+            const size_t fill_count = job_count / 10;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < fill_count; ++i) {
+                RCGREEDY::RCGREEDY_Job job{i, speedup(generator)};
+                rcg.add_job(job, false);
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            std::cout << ", " << rcg.memory_footprint() / 1048576.0 << " MiB after " << fill_count << " adds ("
+                      << std::chrono::duration<double>(end - start).count() * 1e9 / fill_count << " ns/add)";
+        }
+        std::cout << "\n";
+    }
+}
+
+void objective_kernel_report() {
+    const size_t servers = 1000;
+    const size_t calls = 20000;
+    std::vector<double> values(OBJECTIVE_BATCH);
+    Objective_Params params{1.0, 0.3, 12.0, 0.8, 7.0, static_cast<double>(servers)};
+
+    std::cout << "---- GREEDY* objective kernels, " << servers << " candidate splits per call ----\n";
+    for (Objective_Kernel kernel : supported_objective_kernels()) {
+        double checksum = 0.0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t call = 0; call < calls; ++call) {
+            params.p1 = 0.3 + call * 1e-9;  // keep the compiler from hoisting the work
+            for (size_t first = 0; first <= servers; first += OBJECTIVE_BATCH) {
+                size_t count = std::min(OBJECTIVE_BATCH, servers - first + 1);
+                kernel(params, first, count, values.data());
+                checksum += values[0];
+            }
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        std::cout << std::setw(7) << objective_kernel_name(kernel) << ": "
+                  << std::fixed << std::setprecision(3)
+                  << std::chrono::duration<double>(end - start).count() * 1e9 / (calls * (servers + 1))
+                  << " ns/candidate (checksum " << std::setprecision(1) << checksum << ")\n";
+    }
+}
+
+void churn_report() {
+    const size_t live_jobs = 2000;
+    const size_t operations = 200000;
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<double> speedup(0.0, 1.0);
+
+    // replaces random jobs without local reallocation, so the root to leaf walks dominate
+    std::cout << "---- RCGREEDY add/delete churn, " << live_jobs << " live jobs ----\n";
+    for (size_t depth : {1, 3, 5, 8, 10}) {
+        RCGREEDY rcg(1000, depth, 1.0, true);
+        rcg.reserve(live_jobs);
+        std::vector<RCGREEDY::RCGREEDY_Job> live;
+        for (size_t i = 0; i < live_jobs; ++i) {
+            live.push_back({i, speedup(generator)});
+            rcg.add_job(live.back(), true);
+        }
+
+        size_t next_id = live_jobs;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < operations; ++i) {
+            RCGREEDY::RCGREEDY_Job &job = live[generator() % live_jobs];
+            rcg.delete_job(job, false);
+            job = {next_id++, speedup(generator)};
+            rcg.add_job(job, false);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        std::cout << "depth " << std::setw(2) << depth << ": " << std::fixed << std::setprecision(1)
+                  << std::chrono::duration<double>(end - start).count() * 1e9 / (2 * operations) << " ns/op\n";
+    }
+}
+
+void fanout_report() {
+    const size_t live_jobs = 2000;
+    const size_t operations = 200000;
+    const size_t reallocs = 200;
+
+    // a depth of 6 bits is a whole number of levels for fanouts 2, 4 and 8, so every tree has
+    // the same 64 leaves (12 would be the next, past MAX_DEPTH)
+    const size_t depth = 6;
+    std::cout << "---- RCGREEDY fanout, depth " << depth << " (" << (size_t(1) << depth) << " bins for every fanout), "
+              << live_jobs << " live jobs ----\n";
+    for (size_t fanout : {2, 4, 8}) {
+        std::mt19937 generator(1);
+        std::uniform_real_distribution<double> speedup(0.0, 1.0);
+        RCGREEDY rcg(1000, depth, 1.0, true);
+        rcg.set_fanout(fanout);
+        rcg.reserve(live_jobs);
+        std::vector<RCGREEDY::RCGREEDY_Job> live;
+        for (size_t i = 0; i < live_jobs; ++i) {
+            live.push_back({i, speedup(generator)});
+            rcg.add_job(live.back(), false);
+        }
+
+        size_t next_id = live_jobs;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < operations; ++i) {
+            RCGREEDY::RCGREEDY_Job &job = live[generator() % live_jobs];
+            rcg.delete_job(job, false);
+            job = {next_id++, speedup(generator)};
+            rcg.add_job(job, false);
+        }
+        auto middle = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < reallocs; ++i) rcg.full_realloc();
+        auto end = std::chrono::high_resolution_clock::now();
+
+        std::cout << "fanout " << fanout << ": " << std::fixed << std::setprecision(1)
+                  << std::chrono::duration<double>(middle - start).count() * 1e9 / (2 * operations) << " ns/op, "
+                  << std::chrono::duration<double>(end - middle).count() * 1e6 / reallocs << " us/full realloc\n";
+    }
+}
+
+void snapshot_report() {
+    const size_t job_count = 200000;
+    const std::string path = "/tmp/rcgreedy-benchmark.snap";
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<double> speedup(0.0, 1.0);
+    std::vector<RCGREEDY::RCGREEDY_Job> live;
+    for (size_t i = 0; i < job_count; ++i) live.push_back({i, speedup(generator)});
+
+    std::cout << "---- RCGREEDY restart with " << job_count << " live jobs, depth 10 ----\n";
+
+    // a restart without snapshots replays every live job, then reallocates once
+    auto start = std::chrono::high_resolution_clock::now();
+    RCGREEDY replayed(1000, 10, 1.0, true);
+    replayed.reserve(job_count);
+    for (auto &job : live) replayed.add_job(job, false);
+    replayed.full_realloc();
+    auto replay_end = std::chrono::high_resolution_clock::now();
+
+    replayed.save_snapshot(path);
+    auto save_end = std::chrono::high_resolution_clock::now();
+    std::unique_ptr<RCGREEDY> restored = RCGREEDY::load_snapshot(path);
+    auto restore_end = std::chrono::high_resolution_clock::now();
+
+    // check the restored scheduler answers like the original
+    bool same = restored != nullptr;
+    for (size_t i = 0; same && i < job_count; i += 997) {
+        same = replayed.get_server_count(live[i]) == restored->get_server_count(live[i]);
+    }
+    std::ifstream image(path, std::ios::binary | std::ios::ate);
+    double image_mib = image.tellg() / 1048576.0;
+    std::remove(path.c_str());
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "replay " << std::chrono::duration<double>(replay_end - start).count() * 1e3 << " ms, "
+              << "snapshot " << std::chrono::duration<double>(save_end - replay_end).count() * 1e3 << " ms, "
+              << "restore " << std::chrono::duration<double>(restore_end - save_end).count() * 1e3 << " ms ("
+              << image_mib << " MiB image" << (same ? "" : ", MISMATCH") << ")\n";
+}
+
+void pipeline_report() {
+    const size_t job_count = 400000;
+    const std::vector<int> schedulers = {E, R3, R5};
+    std::cout << "---- EQUI, RCGREEDY depth 3 and 5 over " << job_count << " arrivals, 100 servers ----\n";
+
+    // the single threaded run generates every arrival before scheduling the first
+    auto start = std::chrono::high_resolution_clock::now();
+    auto events = generate_events(job_count, 1.0, 0.02, 1);
+    std::vector<SimulationResults> sequential = lockstep_runner(events, schedulers, 100, true, 10, 0.02);
+    auto end = std::chrono::high_resolution_clock::now();
+    double sequential_time = std::chrono::duration<double>(end - start).count();
+
+    std::vector<SimulationResults> pipelined = pipelined_runner(job_count, 1.0, 0.02, 1, 0.0, 1.0, schedulers,
+                                                                100, true, 10);
+    bool same = true;
+    for (size_t i = 0; i < schedulers.size(); ++i) {
+        same = same && sequential[i].avg_processing_time == pipelined[i].avg_processing_time;
+    }
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "single thread " << sequential_time * 1e3 << " ms, "
+              << "pipelined " << pipelined[0].wall_time * 1e3 << " ms"
+              << (same ? "" : " (MISMATCH)") << "\n";
+}
+
+void event_set_report() {
+    const size_t holds = 2000000;
+    std::cout << "---- future event sets, " << holds << " holds (pop the earliest, push one later) ----\n";
+
+    // spread: exponential increments. clustered: most events land close together, a few far off,
+    // like the completions of jobs sharing servers
+    for (bool clustered : {false, true}) {
+        for (size_t population : {64, 4096, 262144}) {
+            std::cout << (clustered ? "clustered" : "spread") << ", " << population << " events:";
+            for (Event_Set_Kind kind : {Event_Set_Kind::HEAP, Event_Set_Kind::CALENDAR}) {
+                std::mt19937 generator(1);
+                std::exponential_distribution<double> increment(1.0);
+                auto draw = [&]() {
+                    if (!clustered) return increment(generator);
+                    return generator() % 10 == 0 ? 100.0 * increment(generator) : 0.001 * increment(generator);
+                };
+
+                std::unique_ptr<Event_Set> events = make_event_set(kind);
+                for (size_t i = 0; i < population; ++i) events->push(Event{COMPLETION, draw(), Job{}});
+
+                auto start = std::chrono::high_resolution_clock::now();
+                long double checksum = 0.0;
+                for (size_t i = 0; i < holds; ++i) {
+                    Event event = events->top();
+                    events->pop();
+                    checksum += event.event_time;
+                    event.event_time += draw();
+                    events->push(event);
+                }
+                auto end = std::chrono::high_resolution_clock::now();
+
+                std::cout << (kind == Event_Set_Kind::HEAP ? " heap " : ", calendar ") << std::fixed << std::setprecision(1)
+                          << std::chrono::duration<double>(end - start).count() * 1e9 / holds << " ns/hold";
+                if (checksum < 0) std::cout << "!";
+            }
+            std::cout << "\n";
+        }
+    }
+
+    // completion events in an actual run, EQUI plus RCGREEDY depth 3 on 100 servers
+    auto events = generate_events(200000, 1.0, 0.02, 1);
+    for (Event_Set_Kind kind : {Event_Set_Kind::HEAP, Event_Set_Kind::CALENDAR}) {
+        SimulationOptions options;
+        options.event_set = kind;
+        auto start = std::chrono::high_resolution_clock::now();
+        lockstep_runner(events, {E, R3}, 100, true, 10, 0.02, options);
+        auto end = std::chrono::high_resolution_clock::now();
+        std::cout << (kind == Event_Set_Kind::HEAP ? "simulation with the heap " : "simulation with the calendar ")
+                  << std::fixed << std::setprecision(1) << std::chrono::duration<double>(end - start).count() * 1e3 << " ms\n";
+    }
+}
+
+int benchmarks() {
+    memory_footprint_report();
+    objective_kernel_report();
+    churn_report();
+    fanout_report();
+    snapshot_report();
+    pipeline_report();
+    event_set_report();
+    return 0;
+}
@@ -0,0 +1,38 @@
+#ifndef BENCHMARKS_HPP
+#define BENCHMARKS_HPP
+
+#include "rcgreedy_base.hpp"
+#include "simulator.hpp"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <random>
+
+/*
+* runs the scheduler micro benchmarks and prints a report for each of them
+*/
+int benchmarks();
+
+// memory held by RCGREEDY per million live jobs, for several depths
+void memory_footprint_report();
+
+// throughput of each supported GREEDY* objective kernel
+void objective_kernel_report();
+
+// cost of an add or delete at several depths, with the job population held constant
+void churn_report();
+
+// cost of add/delete and of a full reallocation with 64 bins, for every fanout
+void fanout_report();
+
+// restart time from replaying every live job through add_job, against a snapshot and restore
+void snapshot_report();
+
+// wall time of a long simulation run on one thread, against generation, scheduling and metrics pipelined
+void pipeline_report();
+
+// push/pop throughput of each future event set in the hold model, and a simulation run on each
+void event_set_report();
+
+#endif // BENCHMARKS_HPP
@@ -0,0 +1,356 @@
+#include "differential_fuzz.hpp"
+#include <chrono>
+#include <map>
+#include <sstream>
+
+// p values are multiples of this, see random_fuzz_case
+const double P_GRID = 4096.0;
+
+Fuzz_Case random_fuzz_case(std::mt19937 &generator, size_t max_ops) {
+    Fuzz_Case fuzz_case;
+    fuzz_case.servers = generator() % 8 == 0 ? 1 + generator() % 200 : 1 + generator() % 16;
+    fuzz_case.depth = generator() % 7;
+    fuzz_case.partial_servers = generator() % 2;
+    fuzz_case.kernel = generator() % 3;
+    if (!fuzz_case.partial_servers && generator() % 3 == 0) {
+        fuzz_case.admission = generator() % 2 ? RCGREEDY::Admission::FCFS : RCGREEDY::Admission::SMALLEST_P;
+    }
+    if (generator() % 4 == 0) fuzz_case.fanout = generator() % 2 ? 4 : 8;
+    if (generator() % 5 == 0) {
+        fuzz_case.rebalance_interval = 1 + generator() % 30;
+        fuzz_case.rebalance_window = 1 + generator() % 64;
+    }
+    if (generator() % 5 == 0) {
+        fuzz_case.tune_interval = 1 + generator() % 30;
+        const double weights[] = {0.0, 1e-5, 1e-3};
+        fuzz_case.evaluation_weight = weights[generator() % 3];
+    }
+
+    // ids mostly come from the live set so deletes and updates hit, with some misses
+    std::vector<size_t> live;
+    size_t next_id = 0;
+    auto random_p = [&]() {
+        if (generator() % 5 == 0) {
+            size_t bins = size_t(1) << (generator() % (fuzz_case.depth + 1));
+            return static_cast<double>(generator() % (bins + 1)) / bins;
+        }
+        return static_cast<double>(generator() % (static_cast<size_t>(P_GRID) + 1)) / P_GRID;
+    };
+    auto random_live = [&]() {
+        if (live.empty() || generator() % 20 == 0) return static_cast<size_t>(generator() % (next_id + 1));
+        return live[generator() % live.size()];
+    };
+
+    size_t op_count = 1 + generator() % std::max<size_t>(max_ops, 1);
+    for (size_t i = 0; i < op_count; ++i) {
+        Fuzz_Op op;
+        size_t roll = generator() % 100;
+        op.local = generator() % 2;
+        if (roll < 40) {
+            op.type = Fuzz_Op::ADD;
+            op.id = generator() % 20 == 0 ? random_live() : next_id++;
+            op.p = random_p();
+            if (std::find(live.begin(), live.end(), op.id) == live.end()) live.push_back(op.id);
+        } else if (roll < 65) {
+            op.type = Fuzz_Op::DELETE;
+            op.id = random_live();
+            auto it = std::find(live.begin(), live.end(), op.id);
+            if (it != live.end()) live.erase(it);
+        } else if (roll < 75) {
+            op.type = Fuzz_Op::UPDATE_P;
+            op.id = random_live();
+            op.p = random_p();
+        } else if (roll < 83) {
+            op.type = Fuzz_Op::FULL_REALLOC;
+        } else if (roll < 89) {
+            op.type = Fuzz_Op::REALLOC_STEP;
+            op.value = 1 + generator() % 8;
+        } else if (roll < 95) {
+            op.type = Fuzz_Op::REALLOC_PASS;
+            op.value = 1 + generator() % 8;
+        } else {
+            op.type = Fuzz_Op::SERVERS;
+            op.value = 1 + generator() % (2 * fuzz_case.servers);
+        }
+        fuzz_case.ops.push_back(op);
+    }
+    return fuzz_case;
+}
+
+// checks RCGREEDY's allocations after an operation against the ones before it (which are then
+// replaced). After a full reallocation (full) every server must be held, and the allocations
+// must match the reference if compare. With admission queues (queues), a new job may wait at
+// 0 servers without being listed. Returns a description of the first failed check
+static std::string check_allocations(RCGREEDY &rcgreedy, const Reference_RCGREEDY &reference,
+                                     std::map<size_t, double> &allocations, bool full, bool compare,
+                                     bool queues) {
+    std::ostringstream failure;
+    std::vector<std::pair<size_t, double>> reported;
+    rcgreedy.get_all_server_count(reported);
+
+    std::map<size_t, double> current;
+    double total = 0.0;
+    for (const auto &[id, servers] : reported) {
+        if (!reference.contains(id)) {
+            failure << "get_all_server_count reports job " << id << ", which isn't in the scheduler";
+            return failure.str();
+        }
+        if (!current.emplace(id, servers).second) {
+            failure << "get_all_server_count reports job " << id << " twice";
+            return failure.str();
+        }
+        if (servers < 0 || (!rcgreedy.partial_servers && servers != std::floor(servers))) {
+            failure << "job " << id << " holds " << servers << " servers";
+            return failure.str();
+        }
+        total += servers;
+    }
+    if (current.size() != reference.job_count()) {
+        failure << "get_all_server_count reports " << current.size() << " of " << reference.job_count() << " jobs";
+        return failure.str();
+    }
+
+    // servers are conserved: never more than exist, and all of them after a full reallocation
+    double server_count = static_cast<double>(rcgreedy.get_server_count());
+    double slack = 1e-9 * std::max(server_count, 1.0);
+    if (total > server_count + slack || (full && !current.empty() && total < server_count - slack)) {
+        failure << "jobs hold " << total << " of " << server_count << " servers";
+        return failure.str();
+    }
+
+    for (const auto &[id, servers] : current) {
+        RCGREEDY::RCGREEDY_Job job;
+        job.id = id;
+        if (rcgreedy.get_server_count(job) != servers) {
+            failure << "get_server_count gives job " << id << " " << rcgreedy.get_server_count(job)
+                    << " servers, get_all_server_count " << servers;
+            return failure.str();
+        }
+    }
+
+    // the history lists every changed job, at its current allocation
+    std::map<size_t, double> listed;
+    for (const auto &[id, servers] : rcgreedy.get_server_changes()) {
+        if (!current.count(id)) {
+            failure << "get_server_changes lists job " << id << ", which isn't in the scheduler";
+            return failure.str();
+        }
+        listed[id] = servers;
+    }
+    for (const auto &[id, servers] : listed) {
+        if (current[id] != servers) {
+            failure << "get_server_changes lists job " << id << " at " << servers << " servers, it holds " << current[id];
+            return failure.str();
+        }
+    }
+    for (const auto &[id, servers] : current) {
+        auto before = allocations.find(id);
+        bool waits = queues && before == allocations.end() && servers == 0.0;
+        if ((before == allocations.end() || before->second != servers) && !waits && !listed.count(id)) {
+            failure << "job " << id << " moved to " << servers << " servers without being listed in get_server_changes";
+            return failure.str();
+        }
+    }
+
+    if (compare) {
+        for (const auto &[id, servers] : reference.allocate()) {
+            if (current[id] != servers) {
+                failure << "job " << id << " holds " << current[id] << " servers, the reference gives it " << servers;
+                return failure.str();
+            }
+        }
+    }
+
+    allocations = std::move(current);
+    return "";
+}
+
+std::string run_fuzz_case(const Fuzz_Case &fuzz_case) {
+    RCGREEDY rcgreedy(fuzz_case.servers, fuzz_case.depth, 1.0, fuzz_case.partial_servers);
+    std::vector<Objective_Kernel> kernels = supported_objective_kernels();
+    rcgreedy.set_objective_kernel(kernels[fuzz_case.kernel % kernels.size()]);
+    rcgreedy.set_admission(fuzz_case.admission);
+    rcgreedy.set_fanout(fuzz_case.fanout);
+    if (fuzz_case.rebalance_interval) rcgreedy.set_adaptive_bins(fuzz_case.rebalance_interval, fuzz_case.rebalance_window);
+    if (fuzz_case.tune_interval) rcgreedy.set_auto_depth(fuzz_case.tune_interval, fuzz_case.evaluation_weight);
+    const bool queues = fuzz_case.admission != RCGREEDY::Admission::ALL;
+    Reference_RCGREEDY reference(fuzz_case.servers, fuzz_case.depth, 1.0, fuzz_case.partial_servers);
+    std::map<size_t, double> allocations;
+
+    for (size_t i = 0; i < fuzz_case.ops.size(); ++i) {
+        const Fuzz_Op &op = fuzz_case.ops[i];
+        RCGREEDY::RCGREEDY_Job job;
+        job.id = op.id;
+        job.p = op.p;
+        bool full = false;
+
+        switch (op.type) {
+            case Fuzz_Op::ADD:
+                if (reference.contains(op.id)) continue;
+                rcgreedy.add_job(job, op.local);
+                reference.add_job(op.id, op.p);
+                break;
+            case Fuzz_Op::DELETE:
+                if (!reference.contains(op.id)) continue;
+                rcgreedy.delete_job(job, op.local);
+                reference.delete_job(op.id);
+                break;
+            case Fuzz_Op::UPDATE_P:
+                if (!reference.contains(op.id)) continue;
+                rcgreedy.update_job_p(job, op.p, op.local);
+                reference.update_job_p(op.id, op.p);
+                break;
+            case Fuzz_Op::FULL_REALLOC:
+                rcgreedy.full_realloc();
+                full = true;
+                break;
+            case Fuzz_Op::REALLOC_STEP:
+                rcgreedy.realloc_step(op.value);
+                break;
+            case Fuzz_Op::REALLOC_PASS:
+                // a pass started before may have seen other jobs, only a fresh one is compared
+                if (rcgreedy.realloc_in_progress()) {
+                    while (!rcgreedy.realloc_step(op.value)) {}
+                    std::string failure = check_allocations(rcgreedy, reference, allocations, true, false, queues);
+                    if (!failure.empty()) return "operation " + std::to_string(i) + ": " + failure;
+                }
+                while (!rcgreedy.realloc_step(op.value)) {}
+                full = true;
+                break;
+            case Fuzz_Op::SERVERS:
+                rcgreedy.set_server_count(op.value);
+                reference.set_server_count(op.value);
+                break;
+        }
+
+        std::string failure = check_allocations(rcgreedy, reference, allocations, full,
+                                                full && fuzz_case.mirrored(), queues);
+        if (!failure.empty()) return "operation " + std::to_string(i) + ": " + failure;
+    }
+    return "";
+}
+
+Fuzz_Case shrink_fuzz_case(Fuzz_Case fuzz_case, const std::function<bool(const Fuzz_Case &)> &fails) {
+    bool progress = true;
+    while (progress) {
+        progress = false;
+
+        // drop runs of operations, halving the run length
+        for (size_t run = std::max<size_t>(fuzz_case.ops.size() / 2, 1); run > 0; run /= 2) {
+            for (size_t start = 0; start < fuzz_case.ops.size();) {
+                Fuzz_Case candidate = fuzz_case;
+                candidate.ops.erase(candidate.ops.begin() + start,
+                                    candidate.ops.begin() + std::min(start + run, candidate.ops.size()));
+                if (fails(candidate)) {
+                    fuzz_case = std::move(candidate);
+                    progress = true;
+                } else {
+                    start += run;
+                }
+            }
+        }
+
+        // then make the scheduler smaller
+        for (size_t servers : {size_t(1), fuzz_case.servers / 2, fuzz_case.servers - 1}) {
+            if (servers < 1 || servers >= fuzz_case.servers) continue;
+            Fuzz_Case candidate = fuzz_case;
+            candidate.servers = servers;
+            if (fails(candidate)) {
+                fuzz_case = std::move(candidate);
+                progress = true;
+                break;
+            }
+        }
+        if (fuzz_case.depth > 0) {
+            Fuzz_Case candidate = fuzz_case;
+            candidate.depth -= 1;
+            if (fails(candidate)) {
+                fuzz_case = std::move(candidate);
+                progress = true;
+            }
+        }
+
+        // and drop the settings the failure doesn't need
+        std::vector<Fuzz_Case> simpler(4, fuzz_case);
+        simpler[0].admission = RCGREEDY::Admission::ALL;
+        simpler[1].fanout = 2;
+        simpler[2].rebalance_interval = 0;
+        simpler[3].tune_interval = 0;
+        for (Fuzz_Case &candidate : simpler) {
+            if (candidate.admission == fuzz_case.admission && candidate.fanout == fuzz_case.fanout
+                && candidate.rebalance_interval == fuzz_case.rebalance_interval
+                && candidate.tune_interval == fuzz_case.tune_interval) continue;
+            if (fails(candidate)) {
+                fuzz_case = std::move(candidate);
+                progress = true;
+                break;
+            }
+        }
+    }
+    return fuzz_case;
+}
+
+std::string describe_fuzz_case(const Fuzz_Case &fuzz_case) {
+    std::ostringstream text;
+    std::vector<Objective_Kernel> kernels = supported_objective_kernels();
+    text << "servers " << fuzz_case.servers << ", depth " << fuzz_case.depth << ", "
+         << (fuzz_case.partial_servers ? "partial" : "whole") << " servers, "
+         << objective_kernel_name(kernels[fuzz_case.kernel % kernels.size()]) << " kernel";
+    if (fuzz_case.admission == RCGREEDY::Admission::FCFS) text << ", FCFS admission";
+    if (fuzz_case.admission == RCGREEDY::Admission::SMALLEST_P) text << ", SMALLEST_P admission";
+    if (fuzz_case.fanout != 2) text << ", fanout " << fuzz_case.fanout;
+    if (fuzz_case.rebalance_interval) {
+        text << ", adaptive bins every " << fuzz_case.rebalance_interval << " adds over " << fuzz_case.rebalance_window << " p values";
+    }
+    if (fuzz_case.tune_interval) {
+        text << ", auto depth every " << fuzz_case.tune_interval << " adds weighing " << fuzz_case.evaluation_weight << " per evaluation";
+    }
+    text << "\n";
+
+    auto p_text = [](double p) { return std::to_string(static_cast<size_t>(p * P_GRID)) + "/4096"; };
+    for (const Fuzz_Op &op : fuzz_case.ops) {
+        switch (op.type) {
+            case Fuzz_Op::ADD: text << "add " << op.id << " p=" << p_text(op.p); break;
+            case Fuzz_Op::DELETE: text << "delete " << op.id; break;
+            case Fuzz_Op::UPDATE_P: text << "update_job_p " << op.id << " p=" << p_text(op.p); break;
+            case Fuzz_Op::FULL_REALLOC: text << "full_realloc"; break;
+            case Fuzz_Op::REALLOC_STEP: text << "realloc_step " << op.value; break;
+            case Fuzz_Op::REALLOC_PASS: text << "realloc_step " << op.value << " until committed, twice"; break;
+            case Fuzz_Op::SERVERS: text << "set_server_count " << op.value; break;
+        }
+        if ((op.type == Fuzz_Op::ADD || op.type == Fuzz_Op::DELETE || op.type == Fuzz_Op::UPDATE_P) && op.local) {
+            text << " (local realloc)";
+        }
+        text << "\n";
+    }
+    return text.str();
+}
+
+int run_fuzz(const Fuzz_Options &options) {
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&]() { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); };
+
+    size_t cases = 0;
+    size_t operations = 0;
+    while (options.max_cases ? cases < options.max_cases : elapsed() < options.seconds) {
+        std::mt19937 generator(options.seed + cases);
+        Fuzz_Case fuzz_case = random_fuzz_case(generator, options.max_ops);
+        std::string failure = run_fuzz_case(fuzz_case);
+
+        if (!failure.empty()) {
+            std::cout << "Case " << cases << " (seed " << options.seed + cases << ") failed at " << failure << "\n"
+                      << "shrinking " << fuzz_case.ops.size() << " operations..." << std::endl;
+            Fuzz_Case shrunk = shrink_fuzz_case(fuzz_case, [](const Fuzz_Case &candidate) {
+                return !run_fuzz_case(candidate).empty();
+            });
+            std::cout << "smallest failing case, " << run_fuzz_case(shrunk) << ":\n" << describe_fuzz_case(shrunk);
+            return 1;
+        }
+        cases += 1;
+        operations += fuzz_case.ops.size();
+    }
+
+    std::cout << cases << " cases, " << operations << " operations in " << elapsed()
+              << " s, RCGREEDY matched the reference" << std::endl;
+    return 0;
+}
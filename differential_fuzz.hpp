@@ -0,0 +1,98 @@
+#ifndef DIFFERENTIAL_FUZZ_HPP
+#define DIFFERENTIAL_FUZZ_HPP
+
+#include "rcgreedy_base.hpp"
+#include "reference_rcgreedy.hpp"
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+// settings of the differential fuzzer, see run_fuzz
+struct Fuzz_Options {
+    double seconds = 10.0;      // time budget, cases are generated until it runs out
+    size_t max_cases = 0;       // if > 0, stop after this many cases instead
+    unsigned seed = 1;          // case i is generated from seed + i, so any case can be replayed alone
+    size_t max_ops = 300;       // operations per case
+};
+
+// one step of a fuzz case
+struct Fuzz_Op {
+    enum Type {
+        ADD,            // add job id with p, with a local reallocation if local
+        DELETE,         // delete job id
+        UPDATE_P,       // move job id to p
+        FULL_REALLOC,
+        REALLOC_STEP,   // realloc_step(value)
+        REALLOC_PASS,   // finish any incremental reallocation, then run a whole new one in steps of value
+        SERVERS         // set_server_count(value)
+    };
+
+    Type type = ADD;
+    size_t id = 0;
+    double p = 0.0;
+    bool local = false;
+    size_t value = 0;
+};
+
+// a scheduler configuration and the operations applied to it
+struct Fuzz_Case {
+    size_t servers = 1;
+    size_t depth = 0;
+    bool partial_servers = true;
+    size_t kernel = 0;          // index into supported_objective_kernels(), wrapped to the ones available
+    RCGREEDY::Admission admission = RCGREEDY::Admission::ALL;   // the reference has no queues, with them only the invariants are checked
+
+    // tree settings the reference can't mirror either, see mirrored
+    size_t fanout = 2;
+    size_t rebalance_interval = 0;  // set_adaptive_bins(rebalance_interval, rebalance_window) if > 0
+    size_t rebalance_window = 1;
+    size_t tune_interval = 0;       // set_auto_depth(tune_interval, evaluation_weight) if > 0
+    double evaluation_weight = 0.0;
+
+    std::vector<Fuzz_Op> ops;
+
+    // true if the reference models this case: a fanout of 2, even bins, a fixed depth and no queues
+    bool mirrored() const {
+        return admission == RCGREEDY::Admission::ALL && fanout == 2 && !rebalance_interval && !tune_interval;
+    }
+};
+
+/*
+* returns a random case of up to max_ops operations. p values are multiples of 1/4096 (bin
+* edges included), so every sum of them is exact and the group statistics RCGREEDY keeps
+* incrementally match the ones the reference recomputes, bit for bit
+*/
+Fuzz_Case random_fuzz_case(std::mt19937 &generator, size_t max_ops);
+
+/*
+* applies fuzz_case to RCGREEDY and to Reference_RCGREEDY. Operations the model can't take
+* (adding a live id, deleting or updating a missing one) are skipped on both. After every
+* operation RCGREEDY must report every live job exactly once with a non negative allocation
+* (whole numbers without partial servers), hand out no more than its servers, agree with
+* get_server_count, and list in get_server_changes every job whose allocation changed, at its
+* current value. After a full reallocation, or a complete incremental pass, the jobs must hold
+* every server, and if the reference mirrors the case each job must hold exactly the reference's
+* allocation. Returns an empty string if every check holds, otherwise a description of the
+* first failed one
+*/
+std::string run_fuzz_case(const Fuzz_Case &fuzz_case);
+
+/*
+* shrinks a case for which fails returns true: drops runs of operations (halving the run
+* length down to single operations) while it keeps failing, then lowers the servers and
+* the depth and turns off the tree settings it doesn't need. Returns the smallest failing
+* case found
+*/
+Fuzz_Case shrink_fuzz_case(Fuzz_Case fuzz_case, const std::function<bool(const Fuzz_Case &)> &fails);
+
+// returns the case as text, one operation per line
+std::string describe_fuzz_case(const Fuzz_Case &fuzz_case);
+
+/*
+* runs random cases until the budget runs out. On the first failure the case is shrunk and
+* printed with the check it failed. Returns the exit code, 1 if a case failed
+*/
+int run_fuzz(const Fuzz_Options &options);
+
+#endif // DIFFERENTIAL_FUZZ_HPP
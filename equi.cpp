@@ -1,4 +1,5 @@
 #include "equi.hpp"
+#include "snapshot_image.hpp"
 
 EQUI::EQUI(size_t servers, bool partial_server_allocs = false) : server_count(servers), partial_servers(partial_server_allocs) {}
 
@@ -75,4 +76,58 @@ void EQUI::get_all_allocations(std::vector<std::pair<size_t, double>> &input) {
 }
 
 size_t EQUI::get_server_count() const { return server_count; }
+void EQUI::set_server_count(size_t servers) { server_count = servers; }
 size_t EQUI::get_current_job_count() const { return jobs.size(); }
+
+// version and size_t width, the only layout the image depends on
+static const uint64_t EQUI_LAYOUT = uint64_t(1) << 48 | sizeof(size_t);
+
+void EQUI::snapshot(std::vector<char> &image) const {
+    Image_Writer writer(image);
+    writer.header(EQUI_IMAGE, EQUI_LAYOUT);
+    writer.put(server_count);
+    writer.put(partial_servers);
+    writer.put(jobs.bucket_count());
+    writer.put_vector(std::vector<size_t>(jobs.begin(), jobs.end()));
+}
+
+std::unique_ptr<EQUI> EQUI::restore(const char *image, size_t size) {
+    Image_Reader reader(image, size);
+    size_t servers = 0, buckets = 0;
+    bool partial = false;
+    std::vector<size_t> job_ids;
+    reader.header(EQUI_IMAGE, EQUI_LAYOUT);
+    reader.get(servers);
+    reader.get(partial);
+    reader.get(buckets);
+    reader.get_vector(job_ids);
+    if (!reader.good()) {
+        std::cerr << "Error restoring EQUI, the image is truncated or wasn't written by this build" << std::endl;
+        return nullptr;
+    }
+
+    // with the same buckets, inserting in reverse rebuilds the same iteration order
+    auto equi = std::make_unique<EQUI>(servers, partial);
+    equi->jobs.rehash(buckets);
+    for (auto it = job_ids.rbegin(); it != job_ids.rend(); ++it) equi->jobs.insert(*it);
+    return equi;
+}
+
+bool EQUI::save_snapshot(const std::string &path) const {
+    std::vector<char> image;
+    snapshot(image);
+    if (!write_image_file(path, image)) {
+        std::cerr << "Error writing snapshot " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<EQUI> EQUI::load_snapshot(const std::string &path) {
+    Mapped_File file(path);
+    if (!file.data()) {
+        std::cerr << "Error reading snapshot " << path << std::endl;
+        return nullptr;
+    }
+    return restore(file.data(), file.size());
+}
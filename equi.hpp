@@ -3,6 +3,8 @@
 
 #include <unordered_set>
 #include <iostream>
+#include <memory>
+#include <string>
 #include <vector>
 
 
@@ -27,8 +29,24 @@ class EQUI {
         void get_all_allocations(std::vector<std::pair<size_t, double>> &input);
 
         size_t get_server_count() const;
+
+        // changes the number of servers shared by the jobs
+        void set_server_count(size_t servers);
         size_t get_current_job_count() const;
 
+        /*
+        * appends the server count and the job ids, in the set's iteration order, to image.
+        * Whole server remainders go to the first jobs of that order, so restore keeps it
+        */
+        void snapshot(std::vector<char> &image) const;
+
+        // builds an EQUI from an image written by snapshot, null if the image is invalid
+        static std::unique_ptr<EQUI> restore(const char *image, size_t size);
+
+        // snapshot into / restore from the file at path, see RCGREEDY::save_snapshot
+        bool save_snapshot(const std::string &path) const;
+        static std::unique_ptr<EQUI> load_snapshot(const std::string &path);
+
         /*
         * returns the speedup factor of any job with p as the speedup 
         * parameter and servers allocated servers
@@ -1,28 +1,45 @@
 #include "event_generator.hpp"
 
-boost::heap::priority_queue<Event, boost::heap::compare<Compare_Event>> generate_events(
-    size_t num_events, double arrival_lambda, double job_size_lambda) {
+Arrival_Stream::Arrival_Stream(double arrival_lambda, double job_size_lambda, unsigned seed,
+                               double p_min, double p_max)
+    : generator(seed == 0 ? std::random_device{}() : seed), arrival(arrival_lambda),
+      job_size(job_size_lambda), speedup(p_min, p_max) {}
 
-    // set up distributions
-    std::random_device rd;
-    std::mt19937 generator(rd());
-    std::exponential_distribution<long double> arrival(arrival_lambda);
-    std::exponential_distribution<double> job_size(job_size_lambda);
-    std::uniform_real_distribution<double> speedup(0.0, 1.0);
+Event Arrival_Stream::next() {
+    // generate space between events and job size
+    elapsed_time += arrival(generator);
+    double size = job_size(generator);
+    size_t id = next_id++;
+    return Event{ARRIVAL, elapsed_time, Job{id, elapsed_time, size, size, 0.0, speedup(generator)}};
+}
 
-    // tracks current time
-    long double elapsed_time = 0.0;
-    double size;
+boost::heap::priority_queue<Event, boost::heap::compare<Compare_Event>> generate_events(
+    size_t num_events, double arrival_lambda, double job_size_lambda, unsigned seed,
+    double p_min, double p_max) {
 
+    Arrival_Stream stream(arrival_lambda, job_size_lambda, seed, p_min, p_max);
     boost::heap::priority_queue<Event, boost::heap::compare<Compare_Event>> pq;
+    for (size_t i = 0; i < num_events; ++i) pq.push(stream.next());
 
-    for (size_t i = 0; i < num_events; ++i) {
+    return pq;
+}
 
-        // generate space between events and job size, add to pq
-        elapsed_time += arrival(generator);
-        size = job_size(generator);
-        pq.push(Event{ARRIVAL, elapsed_time, Job{i, elapsed_time, size, size, 0.0, speedup(generator)}});
-    }
+std::vector<Event> generate_capacity_events(size_t base_servers, double amplitude, double period,
+                                            long double end_time, size_t steps_per_period) {
+    std::vector<Event> events;
+    size_t current = base_servers;
+    const long double step = period / steps_per_period;
 
-    return pq;
+    for (size_t i = 1; i * step < end_time; ++i) {
+        long double time = i * step;
+        double scale = 1.0 + amplitude * std::sin(2.0 * M_PI * static_cast<double>(time / period));
+        size_t servers = std::max<long>(1, std::lround(base_servers * scale));
+        if (servers == current) continue;
+        current = servers;
+
+        Event event{CAPACITY, time, Job{}};
+        event.servers = servers;
+        events.push_back(event);
+    }
+    return events;
 }
\ No newline at end of file
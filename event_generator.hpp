@@ -2,6 +2,8 @@
 #define EVENT_GENERATOR_HPP
 
 #include <random>
+#include <vector>
+#include <cmath>
 #include <boost/heap/priority_queue.hpp>
 
 // jobs (for use in simulations)
@@ -19,6 +21,8 @@ struct Event {
     int event_type;          // as below
     long double event_time;  // when the event will occur (used as a pq key)
     Job job;
+    size_t servers = 0;      // new server count, CAPACITY events only
+    size_t sequence = 0;     // simulator COMPLETION events only, unique per push, see Scheduler_Sim
 };
 
 // used as a comparison function in pq
@@ -31,14 +35,46 @@ struct Compare_Event {
 // event types
 const int ARRIVAL = 0;       // new arrival into the scheduler
 const int COMPLETION = 1;    // event completion
+const int CAPACITY = 2;      // servers joining or draining
 
 
+/*
+*   the arrivals of generate_events one at a time, in time order, so long runs can be generated
+*   while they are simulated. The same non zero seed produces the same events as generate_events
+*/
+class Arrival_Stream {
+public:
+    Arrival_Stream(double arrival_lambda, double job_size_lambda, unsigned seed = 0,
+                   double p_min = 0.0, double p_max = 1.0);
+
+    // returns the next ARRIVAL event
+    Event next();
+
+private:
+    std::mt19937 generator;
+    std::exponential_distribution<long double> arrival;
+    std::exponential_distribution<double> job_size;
+    std::uniform_real_distribution<double> speedup;
+    long double elapsed_time = 0.0;
+    size_t next_id = 0;
+};
+
 /* 
 *   returns a priority queue containing jobs generated with a job_size_lambda exponential distribution and 
-*   spaced according to a poisson process with arrival_lambda
+*   spaced according to a poisson process with arrival_lambda. The same non zero seed always generates
+*   the same events, a seed of 0 draws a fresh one. Speedup parameters are uniform in [p_min, p_max)
 */
 boost::heap::priority_queue<Event, boost::heap::compare<Compare_Event>> generate_events(
-    size_t num_events, double arrival_lambda, double job_size_lambda);
+    size_t num_events, double arrival_lambda, double job_size_lambda, unsigned seed = 0,
+    double p_min = 0.0, double p_max = 1.0);
+
+/*
+*   returns CAPACITY events in time order, every period / steps_per_period up to end_time, following
+*   an autoscaled pool of base_servers * (1 + amplitude * sin(2 pi t / period)) servers, rounded
+*   and at least 1. Steps that don't change the rounded count are left out
+*/
+std::vector<Event> generate_capacity_events(size_t base_servers, double amplitude, double period,
+                                            long double end_time, size_t steps_per_period = 8);
 
 
 
@@ -0,0 +1,117 @@
+#include "event_set.hpp"
+#include <algorithm>
+
+std::unique_ptr<Event_Set> make_event_set(Event_Set_Kind kind) {
+    if (kind == Event_Set_Kind::CALENDAR) return std::make_unique<Calendar_Event_Set>();
+    return std::make_unique<Heap_Event_Set>();
+}
+
+bool parse_event_set_kind(const std::string& name, Event_Set_Kind& kind) {
+    if (name == "heap") {
+        kind = Event_Set_Kind::HEAP;
+    } else if (name == "calendar") {
+        kind = Event_Set_Kind::CALENDAR;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+
+// buckets kept while the calendar is nearly empty, resizes halve down to this
+const size_t MIN_BUCKETS = 2;
+
+// events whose spacing sets the width on a resize
+const size_t WIDTH_SAMPLE = 25;
+
+Calendar_Event_Set::Calendar_Event_Set() : buckets(MIN_BUCKETS) {}
+
+uint64_t Calendar_Event_Set::day_of(long double time) const {
+    // clamped so far off events still land in a bucket
+    long double day = time / width;
+    return day > 0 ? static_cast<uint64_t>(std::min<long double>(day, 1e18)) : 0;
+}
+
+void Calendar_Event_Set::insert(const Event& event) {
+    uint64_t day = day_of(event.event_time);
+    auto& bucket = buckets[day % buckets.size()];
+    auto later = [](const Event& a, const Event& b) { return a.event_time > b.event_time; };
+    bucket.insert(std::upper_bound(bucket.begin(), bucket.end(), event, later), event);
+
+    // an event before the current day moves the walk back to it
+    current_day = std::min(current_day, day);
+}
+
+void Calendar_Event_Set::push(const Event& event) {
+    if (count == 0) current_day = UINT64_MAX;
+    insert(event);
+    count += 1;
+    earliest_found = false;
+
+    if (count > 2 * buckets.size()) resize(2 * buckets.size());
+}
+
+const Event& Calendar_Event_Set::top() {
+    if (!earliest_found) find_earliest();
+    return buckets[earliest].back();
+}
+
+void Calendar_Event_Set::pop() {
+    if (!earliest_found) find_earliest();
+    buckets[earliest].pop_back();
+    count -= 1;
+    earliest_found = false;
+
+    if (buckets.size() > MIN_BUCKETS && count < buckets.size() / 2) resize(buckets.size() / 2);
+}
+
+void Calendar_Event_Set::find_earliest() {
+    // walk one year of days, the earliest event is usually found within a few
+    for (size_t step = 0; step < buckets.size(); ++step, ++current_day) {
+        const auto& bucket = buckets[current_day % buckets.size()];
+        if (!bucket.empty() && day_of(bucket.back().event_time) == current_day) {
+            earliest = current_day % buckets.size();
+            earliest_found = true;
+            return;
+        }
+    }
+
+    // every event is more than a year ahead, so the days have become too short for them.
+    // Fitting the width again leaves current_day at the day of the earliest event
+    resize(buckets.size());
+    earliest = current_day % buckets.size();
+    earliest_found = true;
+}
+
+void Calendar_Event_Set::resize(size_t bucket_count) {
+    std::vector<Event> events;
+    events.reserve(count);
+    for (auto& bucket : buckets) {
+        events.insert(events.end(), bucket.begin(), bucket.end());
+    }
+
+    // the width is three times the mean spacing of the earliest events, leaving out gaps of
+    // more than twice the mean so a few outliers don't stretch the days
+    size_t sample = std::min(events.size(), WIDTH_SAMPLE);
+    if (sample >= 2) {
+        auto earlier = [](const Event& a, const Event& b) { return a.event_time < b.event_time; };
+        std::partial_sort(events.begin(), events.begin() + sample, events.end(), earlier);
+        long double span = events[sample - 1].event_time - events[0].event_time;
+        long double mean = span / (sample - 1);
+        long double total = 0.0;
+        size_t gaps = 0;
+        for (size_t i = 1; i < sample; ++i) {
+            long double gap = events[i].event_time - events[i - 1].event_time;
+            if (gap <= 2 * mean) {
+                total += gap;
+                gaps += 1;
+            }
+        }
+        if (total > 0) width = 3 * total / gaps;
+    }
+
+    buckets.assign(bucket_count, std::vector<Event>());
+    current_day = UINT64_MAX;
+    for (const Event& event : events) insert(event);
+    earliest_found = false;
+}
@@ -0,0 +1,97 @@
+#ifndef EVENT_SET_HPP
+#define EVENT_SET_HPP
+
+#include "event_generator.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+* the future event set of a simulation: events come out earliest first. Events with equal
+* times come out in an unspecified order
+*/
+class Event_Set {
+public:
+    virtual ~Event_Set() = default;
+
+    virtual void push(const Event& event) = 0;
+
+    // the earliest event, the set must not be empty
+    virtual const Event& top() = 0;
+
+    // removes the earliest event, the set must not be empty
+    virtual void pop() = 0;
+
+    virtual bool empty() const = 0;
+    virtual size_t size() const = 0;
+};
+
+enum class Event_Set_Kind { HEAP, CALENDAR };
+
+/*
+* returns an empty set of kind
+*/
+std::unique_ptr<Event_Set> make_event_set(Event_Set_Kind kind);
+
+/*
+* parses "heap" or "calendar" into kind, returns false and leaves kind alone otherwise
+*/
+bool parse_event_set_kind(const std::string& name, Event_Set_Kind& kind);
+
+
+// a binary heap, O(log n) push and pop
+class Heap_Event_Set : public Event_Set {
+public:
+    void push(const Event& event) override { heap.push(event); }
+    const Event& top() override { return heap.top(); }
+    void pop() override { heap.pop(); }
+    bool empty() const override { return heap.empty(); }
+    size_t size() const override { return heap.size(); }
+
+private:
+    boost::heap::priority_queue<Event, boost::heap::compare<Compare_Event>> heap;
+};
+
+
+/*
+* a calendar queue (Brown 1988), amortised O(1) push and pop when event times are spread
+* evenly. Time is cut into days of width time units, day d goes to bucket d mod the bucket
+* count, and pops walk the buckets one day at a time from the day of the earliest event.
+* The bucket count follows the event count, and every resize takes the width from the
+* spacing of the earliest events. A walk finding no event within a year fits the width again
+*/
+class Calendar_Event_Set : public Event_Set {
+public:
+    Calendar_Event_Set();
+
+    void push(const Event& event) override;
+    const Event& top() override;
+    void pop() override;
+    bool empty() const override { return count == 0; }
+    size_t size() const override { return count; }
+
+private:
+    std::vector<std::vector<Event>> buckets;    // each sorted latest first, so its earliest event is at the back
+    long double width = 1.0;
+    size_t count = 0;
+
+    // no event is before day current_day. Once top has found the earliest event it is
+    // the back of bucket earliest, until the next push or pop
+    uint64_t current_day = 0;
+    size_t earliest = 0;
+    bool earliest_found = false;
+
+    uint64_t day_of(long double time) const;
+
+    // adds event to its bucket without counting it
+    void insert(const Event& event);
+
+    // finds the earliest event, advancing current_day to its day
+    void find_earliest();
+
+    // rebuilds the calendar with bucket_count buckets and a width fitted to the events
+    void resize(size_t bucket_count);
+};
+
+#endif // EVENT_SET_HPP
@@ -3,7 +3,9 @@
 void write_csv_header(const std::string& filename) {
     std::ofstream file(filename, std::ios::trunc);
     if(file.is_open()) {
-        file << "Scheduler,Parameter,Value,AverageProcessingTime,AvgRealTime\n";
+        file << "Scheduler,Parameter,Value,AverageProcessingTime,AvgRealTime,MaxEventTime,"
+             << "CIHalfWidth,PairedCIHalfWidth,Trials,WarmupJobs,ServerMoves,PError,PObservations,"
+             << "EffectiveDepth,Migrations,WallTime\n";
     }
 }
 
@@ -15,7 +17,18 @@ void write_csv_row(const std::string& filename, const std::string& scheduler,
         file << scheduler << "," << param << "," << value << ","
              << std::fixed << std::setprecision(7) 
              << results.avg_processing_time << ","
-             << results.avg_real_time << "\n";
+             << results.avg_real_time << ","
+             << results.max_event_time << ","
+             << results.ci_half_width << ","
+             << results.paired_ci_half_width << ","
+             << results.trials << ","
+             << results.warmup_jobs << ","
+             << results.server_moves << ","
+             << results.p_error << ","
+             << results.p_observations << ","
+             << results.effective_depth << ","
+             << results.migrations << ","
+             << results.wall_time << "\n";
     }
 }
 
@@ -36,161 +49,261 @@ std::string get_scheduler_name(int flag) {
     }
 }
 
-void run_experiment_option(int option, int trials, const std::string& csv_file, int options_to_run) {
+void run_experiment_option(int option, int trials, const std::string& csv_file, int options_to_run,
+                           const TrialOptions& trial_options, const SimulationOptions& base_options) {
     // Extract enabled schedulers
     std::vector<int> enabled_schedulers;
     if(options_to_run & E) enabled_schedulers.push_back(E);
     const std::vector<std::pair<int, int>> r_flags = {{R1,1},{R2,2},{R3,3},{R4,4},
-                                                     {R5,5},{R6,6},{R7,7},{R8,8}};
+                                                     {R5,5},{R6,6},{R7,7},{R8,8},
+                                                     {R9,9}};
 
     for(const auto& [flag, _] : r_flags) {
         if(options_to_run & flag) enabled_schedulers.push_back(flag);
     }
 
+    // every parameter value reuses the same seeds, so points and schedulers are compared on common events
+    unsigned base_seed = trial_options.seed != 0 ? trial_options.seed : std::random_device{}();
+
+    // runs the trials of one parameter value and writes the per-scheduler averages. With a CI target,
+    // trials continue past the requested count until every scheduler's interval is narrow enough
+    auto run_point = [&](const std::string& param, long double value,
+                         const std::function<std::vector<SimulationResults>(unsigned)>& run_trial) {
+        // Store results per scheduler, in enabled_schedulers order
+        std::vector<SimulationResults> total_results(enabled_schedulers.size(), SimulationResults{0.0, 0.0, 0.0});
+        std::vector<std::vector<long double>> samples(enabled_schedulers.size());
+        std::vector<std::vector<long double>> paired_samples(enabled_schedulers.size());
+
+        size_t min_trials = trials;
+        size_t max_trials = trials;
+        if(trial_options.ci_target > 0) {
+            min_trials = std::max<size_t>(trials, 2);
+            max_trials = std::max(min_trials, trial_options.max_trials);
+        }
+
+        size_t t = 0;
+        while(t < max_trials) {
+            // every scheduler sees the same events in a trial, so differences between them are paired
+            auto results = run_trial(base_seed + t);
+            t++;
+            for(size_t i = 0; i < results.size(); i++) {
+                auto& total = total_results[i];
+                total.avg_processing_time += results[i].avg_processing_time;
+                total.avg_real_time += results[i].avg_real_time;
+                total.max_event_time = std::max(total.max_event_time, results[i].max_event_time);
+                total.ci_half_width = results[i].ci_half_width;
+                total.warmup_jobs += results[i].warmup_jobs;
+                total.server_moves += results[i].server_moves;
+                total.p_error += results[i].p_error;
+                total.p_observations += results[i].p_observations;
+                total.effective_depth += results[i].effective_depth;
+                total.migrations += results[i].migrations;
+                total.wall_time += results[i].wall_time;
+                samples[i].push_back(results[i].avg_processing_time);
+                paired_samples[i].push_back(results[i].avg_processing_time - results[0].avg_processing_time);
+            }
+
+            if(t < min_trials) continue;
+            if(trial_options.ci_target <= 0) break;
+
+            bool converged = true;
+            for(size_t i = 0; i < samples.size(); i++) {
+                long double mean = total_results[i].avg_processing_time / t;
+                if(ci_half_width(samples[i]) > trial_options.ci_target * mean) converged = false;
+            }
+            if(converged) break;
+        }
+
+        // Write averages per scheduler
+        for(size_t i = 0; i < total_results.size(); i++) {
+            const auto& total = total_results[i];
+            SimulationResults avg{
+                total.avg_processing_time/t,
+                total.avg_real_time/t,
+                total.max_event_time
+            };
+            // a single run keeps its batch means interval
+            avg.ci_half_width = t > 1 ? ci_half_width(samples[i]) : total.ci_half_width;
+            avg.paired_ci_half_width = ci_half_width(paired_samples[i]);
+            avg.trials = t;
+            avg.warmup_jobs = total.warmup_jobs / t;
+            avg.server_moves = total.server_moves / t;
+            avg.p_error = total.p_error / t;
+            avg.p_observations = total.p_observations / t;
+            avg.effective_depth = total.effective_depth / t;
+            avg.migrations = total.migrations / t;
+            avg.wall_time = total.wall_time / t;
+            write_csv_row(csv_file, get_scheduler_name(enabled_schedulers[i]), param, value, avg);
+        }
+    };
+
     switch(option) {
         case 1: { // Vary num servers
             for(size_t servers = 50; servers <= 200; servers += 25) {
-                // Store results per scheduler
-                std::unordered_map<int, SimulationResults> total_results;
-
-                for(int t = 0; t < trials; t++) {
-                    auto results = experiments_new(options_to_run, servers);
-                    
-                    // Assume results vector order matches enabled_schedulers order
-                    for(size_t i = 0; i < results.size(); i++) {
-                        int scheduler_flag = enabled_schedulers[i];
-                        total_results[scheduler_flag].avg_processing_time += results[i].avg_processing_time;
-                        total_results[scheduler_flag].avg_real_time += results[i].avg_real_time;
-                    }
-                }
-
-                // Write averages per scheduler
-                for(const auto& [flag, total] : total_results) {
-                    SimulationResults avg{
-                        total.avg_processing_time/trials,
-                        total.avg_real_time/trials
-                    };
-                    write_csv_row(csv_file, get_scheduler_name(flag), 
-                                "Servers", servers, avg);
-                }
+                run_point("Servers", servers, [&](unsigned seed) {
+                    return experiments_new(options_to_run, servers, 1.0, 9.0, true, 300, 1, base_options, seed);
+                });
             }
             break;
         }
         
         case 2: { // Vary job size lambda
             for(double lambda = 0.1; lambda <= 20; lambda += 0.5) {
-                 // Store results per scheduler
-                std::unordered_map<int, SimulationResults> total_results;
-
-                for(int t = 0; t < trials; t++) {
-                    auto results = experiments_new(options_to_run, 1000, 20.0, lambda, false);
-                     // Assume results vector order matches enabled_schedulers order
-                    for(size_t i = 0; i < results.size(); i++) {
-                        int scheduler_flag = enabled_schedulers[i];
-                        total_results[scheduler_flag].avg_processing_time += results[i].avg_processing_time;
-                        total_results[scheduler_flag].avg_real_time += results[i].avg_real_time;
-                    }
-                }
-
-                 // Write averages per scheduler
-                for(const auto& [flag, total] : total_results) {
-                    SimulationResults avg{
-                        total.avg_processing_time/trials,
-                        total.avg_real_time/trials
-                    };
-                    write_csv_row(csv_file, get_scheduler_name(flag), 
-                                "JobSizeLambda", lambda, avg);
-                }
+                run_point("JobSizeLambda", lambda, [&](unsigned seed) {
+                    return experiments_new(options_to_run, 1000, 20.0, lambda, false, 300, 1, base_options, seed);
+                });
             }
             break;
         }
 
         case 3: { // Vary arrival lambda
             for(double lambda = 0.5; lambda <= 2.5; lambda += 0.5) {
-                // Store results per scheduler
-                std::unordered_map<int, SimulationResults> total_results;
-
-                for(int t = 0; t < trials; t++) {
-                    auto results = experiments_new(options_to_run, 100, lambda, 1.0);
-                    // Assume results vector order matches enabled_schedulers order
-                    for(size_t i = 0; i < results.size(); i++) {
-                        int scheduler_flag = enabled_schedulers[i];
-                        total_results[scheduler_flag].avg_processing_time += results[i].avg_processing_time;
-                        total_results[scheduler_flag].avg_real_time += results[i].avg_real_time;
-                    }
-                }
-                // Write averages per scheduler
-                for(const auto& [flag, total] : total_results) {
-                    SimulationResults avg{
-                        total.avg_processing_time/trials,
-                        total.avg_real_time/trials
-                    };
-                write_csv_row(csv_file, get_scheduler_name(flag), 
-                                "JobSpacingLambda", lambda, avg);
-                }
-                
+                run_point("JobSpacingLambda", lambda, [&](unsigned seed) {
+                    return experiments_new(options_to_run, 100, lambda, 1.0, true, 300, 1, base_options, seed);
+                });
             }
             break;
         }
 
         case 4: { // Partial vs full servers
             for(bool partial : {true, false}) {
-                // Store results per scheduler
-                std::unordered_map<int, SimulationResults> total_results;
-
-                for(int t = 0; t < trials; t++) {
-                    auto results = experiments_new(options_to_run, 100, 1.0, 1.0, partial);
-                    // Assume results vector order matches enabled_schedulers order
-                    for(size_t i = 0; i < results.size(); i++) {
-                        int scheduler_flag = enabled_schedulers[i];
-                        total_results[scheduler_flag].avg_processing_time += results[i].avg_processing_time;
-                        total_results[scheduler_flag].avg_real_time += results[i].avg_real_time;
-                    }
-                }
-                 // Write averages per scheduler
-                for(const auto& [flag, total] : total_results) {
-                    SimulationResults avg{
-                        total.avg_processing_time/trials,
-                        total.avg_real_time/trials
-                    };
-                write_csv_row(csv_file, get_scheduler_name(flag), 
-                                "PartialServers", partial, avg);
-                }
+                run_point("PartialServers", partial, [&](unsigned seed) {
+                    return experiments_new(options_to_run, 100, 1.0, 1.0, partial, 300, 1, base_options, seed);
+                });
             }
             break;
         }
 
         case 5: { // Reallocation frequency
             for(size_t freq : {1, 5, 10, 15, 20}) {
-               // Store results per scheduler
-                std::unordered_map<int, SimulationResults> total_results;
-                for(int t = 0; t < trials; t++) {
-                    auto results = experiments_new(options_to_run, 100, 1.0, 1.0, true, 1000, freq);
-                    // Assume results vector order matches enabled_schedulers order
-                    for(size_t i = 0; i < results.size(); i++) {
-                        int scheduler_flag = enabled_schedulers[i];
-                        total_results[scheduler_flag].avg_processing_time += results[i].avg_processing_time;
-                        total_results[scheduler_flag].avg_real_time += results[i].avg_real_time;
-                    }
-                }
-                 // Write averages per scheduler
-                for(const auto& [flag, total] : total_results) {
-                    SimulationResults avg{
-                        total.avg_processing_time/trials,
-                        total.avg_real_time/trials
-                    };
-                write_csv_row(csv_file, get_scheduler_name(flag), 
-                                "ReallocationFrequency", freq, avg);
-                }
+                run_point("ReallocationFrequency", freq, [&](unsigned seed) {
+                    return experiments_new(options_to_run, 100, 1.0, 1.0, true, 1000, freq, base_options, seed);
+                });
+            }
+            break;
+        }
+
+        case 6: { // Adaptive (drift driven) reallocation, 0 is the fixed every-event policy
+            for(double threshold : {0.0, 0.05, 0.1, 0.25, 0.5, 1.0}) {
+                SimulationOptions sim_options = base_options;
+                sim_options.realloc_drift_threshold = threshold;
+                run_point("ReallocDriftThreshold", threshold, [&](unsigned seed) {
+                    return experiments_new(options_to_run, 100, 1.0, 1.0, true, 1000, 1, sim_options, seed);
+                });
+            }
+            break;
+        }
+
+        case 7: { // Budgeted incremental reallocation, 0 is a full reallocation every event
+            for(size_t budget : {0, 2, 4, 8, 16, 64}) {
+                SimulationOptions sim_options = base_options;
+                sim_options.realloc_step_budget = budget;
+                run_point("ReallocStepBudget", budget, [&](unsigned seed) {
+                    return experiments_new(options_to_run, 1000, 1.0, 1.0, true, 1000, 1, sim_options, seed);
+                });
+            }
+            break;
+        }
+
+        case 8: { // Admission queues with whole servers under heavy load, 0 = none, 1 = FCFS, 2 = smallest p first
+            const RCGREEDY::Admission orders[] = {RCGREEDY::Admission::ALL, RCGREEDY::Admission::FCFS,
+                                                  RCGREEDY::Admission::SMALLEST_P};
+            for(size_t order = 0; order < 3; order++) {
+                SimulationOptions sim_options = base_options;
+                sim_options.admission = orders[order];
+                run_point("Admission", order, [&](unsigned seed) {
+                    return experiments_new(options_to_run, 4, 3.0, 1.0, false, 1000, 1, sim_options, seed);
+                });
+            }
+            break;
+        }
+
+        case 9: { // Concrete server assignment with whole servers, charging a cost per migrated server
+            for(double cost : {0.0, 0.001, 0.01, 0.05}) {
+                SimulationOptions sim_options = base_options;
+                sim_options.assign_servers = true;
+                sim_options.migration_cost = cost;
+                run_point("MigrationCost", cost, [&](unsigned seed) {
+                    return experiments_new(options_to_run, 100, 1.0, 1.0, false, 1000, 1, sim_options, seed);
+                });
+            }
+            break;
+        }
+
+        case 10: { // Estimated p with noisy progress measurements, -1 is the known p baseline
+            for(double noise : {-1.0, 0.0, 0.05, 0.2, 0.5}) {
+                SimulationOptions sim_options = base_options;
+                sim_options.estimate_p = noise >= 0;
+                sim_options.progress_noise = std::max(noise, 0.0);
+                run_point("ProgressNoise", noise, [&](unsigned seed) {
+                    return experiments_new(options_to_run, 100, 1.0, 1.0, true, 1000, 1, sim_options, seed);
+                });
+            }
+            break;
+        }
+
+        case 11: { // Group tree fanout, each depth keeps its bins with fewer levels
+            for(size_t fanout : {2, 4, 8}) {
+                SimulationOptions sim_options = base_options;
+                sim_options.fanout = fanout;
+                run_point("Fanout", fanout, [&](unsigned seed) {
+                    return experiments_new(options_to_run, 100, 1.0, 1.0, true, 1000, 1, sim_options, seed);
+                });
+            }
+            break;
+        }
+
+        case 12: { // Quantile adaptive bins with p clustered in [0.85, 0.99), 0 keeps the even bins
+            for(size_t interval : {0, 25, 100, 400}) {
+                SimulationOptions sim_options = base_options;
+                sim_options.bin_rebalance_interval = interval;
+                run_point("BinRebalanceInterval", interval, [&](unsigned seed) {
+                    return experiments_new(options_to_run, 100, 1.0, 1.0, true, 1000, 1, sim_options, seed, 0.85, 0.99);
+                });
+            }
+            break;
+        }
+
+        case 13: { // Online depth selection, -1 keeps every scheduler at its full depth
+            for(double weight : {-1.0, 0.0, 1e-5, 1e-4, 1e-3}) {
+                SimulationOptions sim_options = base_options;
+                sim_options.auto_depth_interval = weight >= 0 ? 50 : 0;
+                sim_options.depth_evaluation_weight = std::max(weight, 0.0);
+                run_point("DepthEvaluationWeight", weight, [&](unsigned seed) {
+                    return experiments_new(options_to_run, 100, 1.0, 1.0, true, 1000, 1, sim_options, seed);
+                });
+            }
+            break;
+        }
+
+        case 14: { // Autoscaling, the server count swings by amplitude around 100 every 200 time units
+            for(double amplitude : {0.0, 0.25, 0.5, 0.75}) {
+                SimulationOptions sim_options = base_options;
+                sim_options.capacity_amplitude = amplitude;
+                run_point("CapacityAmplitude", amplitude, [&](unsigned seed) {
+                    return experiments_new(options_to_run, 100, 1.0, 1.0, true, 1000, 1, sim_options, seed);
+                });
+            }
+            break;
+        }
+
+        case 15: { // Federation, 400 servers split over pools under heavy load
+            for(size_t pools : {1, 2, 4, 8}) {
+                SimulationOptions sim_options = base_options;
+                sim_options.pools = pools;
+                run_point("Pools", pools, [&](unsigned seed) {
+                    return experiments_new(options_to_run, 400, 4.0, 0.02, true, 4000, 1, sim_options, seed);
+                });
             }
             break;
         }
     }
 }
 
-void experiments(size_t trials, int option, std::string csv_output_file, bool generate_graphs) {
+void experiments(size_t trials, int option, std::string csv_output_file, bool generate_graphs,
+                 const TrialOptions& trial_options, const SimulationOptions& sim_options) {
     write_csv_header(csv_output_file);
-    run_experiment_option(option, trials, csv_output_file, E|R1|R3|R4|R5|R7|R8);
+    run_experiment_option(option, trials, csv_output_file, E|R1|R3|R4|R5|R7|R8, trial_options, sim_options);
     
     if(generate_graphs) {
         // Add Python plotting code here
@@ -203,36 +316,48 @@ std::vector<SimulationResults> experiments_new(int options_to_run,
                                               double job_size_lambda, 
                                               bool partial_servers, 
                                               size_t jobs, 
-                                              size_t full_realloc_count) {
-
-    // Generate the base event queue
-    auto base_events = generate_events(jobs, job_spacing_lambda, job_size_lambda);
+                                              size_t full_realloc_count,
+                                              const SimulationOptions& options,
+                                              unsigned seed,
+                                              double p_min,
+                                              double p_max) {
 
     // Store results [EQUI, R1, R2, ..., R8]
-    std::vector<SimulationResults> results;
-
-    // Run EQUI if selected
-    if (options_to_run & E) {
-        auto res = simulation_runner(base_events, E, num_servers, partial_servers);
-        results.push_back(res);
-    }
+    std::vector<int> scheduler_types;
+    if (options_to_run & E) scheduler_types.push_back(E);
 
-   // Run RCGREEDY variants
     const std::vector<std::pair<int, int>> r_flags = {
         {R1, 1}, {R2, 2}, {R3, 3}, {R4, 4},
         {R5, 5}, {R6, 6}, {R7, 7}, {R8, 8}, 
         {R9, 9}
     };
 
-    for(const auto& [flag, depth] : r_flags) {
-        if(options_to_run & flag) {
-            auto res = simulation_runner(base_events, flag, num_servers, partial_servers, depth, full_realloc_count, job_size_lambda);
-            results.push_back(res);
-        }
+    for(const auto& [flag, _] : r_flags) {
+        if(options_to_run & flag) scheduler_types.push_back(flag);
     }
 
-    return results;
+    // arrivals are generated while the schedulers run, on their own thread
+    if(options.pipelined && options.pools <= 1) {
+        return pipelined_runner(jobs, job_spacing_lambda, job_size_lambda, seed, p_min, p_max, scheduler_types,
+                                num_servers, partial_servers, full_realloc_count, options);
+    }
 
+    // Generate the base event queue
+    auto base_events = generate_events(jobs, job_spacing_lambda, job_size_lambda, seed, p_min, p_max);
+
+    // federated schedulers each run their own pools over the same arrivals
+    if(options.pools > 1) {
+        std::vector<SimulationResults> results;
+        for(int flag : scheduler_types) {
+            results.push_back(federated_runner(base_events, flag, num_servers, partial_servers,
+                                               full_realloc_count, job_size_lambda, options));
+        }
+        return results;
+    }
+
+    // every scheduler runs side by side over the same arrivals
+    return lockstep_runner(base_events, scheduler_types, num_servers, partial_servers,
+                           full_realloc_count, job_size_lambda, options);
 }
 
 
@@ -243,162 +368,10 @@ SimulationResults simulation_runner(
     bool partial_servers,
     int r_depth,
     size_t full_realloc_count, 
-    double job_size_lambda
+    double job_size_lambda,
+    const SimulationOptions& options
 ) {
-    auto event_queue = events;
-    std::unordered_map<size_t, JobState> job_states;
-    std::unordered_map<size_t, Job> jobs;
-    std::unordered_map<size_t, long double> job_arrival_times;
-    std::vector<double> processing_times;
-    double total_real_time = 0.0;
-    size_t realloc_counter = full_realloc_count;
-    long double current_time = 0.0;
-
-    std::unique_ptr<RCGREEDY> rcgreedy;
-    std::unique_ptr<EQUI> equi;
-    
-    if(scheduler_type == E) {
-        equi = std::make_unique<EQUI>(num_servers, partial_servers);
-    } else {
-        rcgreedy = std::make_unique<RCGREEDY>(num_servers, r_depth, 1.0 / job_size_lambda, partial_servers);
-    }
-
-    auto update_job_processing = [&](size_t job_id, long double update_time, double servers) {
-        auto& state = job_states[job_id];
-        
-        // Calculate processed work since last update
-        double elapsed = update_time - state.last_update_time;
-        state.remaining_size -= state.current_speedup * elapsed;
-        state.last_update_time = update_time;
-
-        // Get new speedup factor
-        double new_speedup;
-        if(scheduler_type == E) {
-            new_speedup = equi->speedup_factor(jobs[job_id].p, servers);
-        } else {
-            new_speedup = rcgreedy->speedup_factor(jobs[job_id].p, servers);
-        }
-        
-        if(new_speedup < 1e-6) new_speedup = 1e-6; // Prevent division by zero
-        
-        // Update state and reschedule
-        state.current_speedup = new_speedup;
-        double new_processing = state.remaining_size / new_speedup;
-        state.expected_completion = update_time + new_processing;
-
-        // Add new completion event
-        Event new_event;
-        new_event.event_type = COMPLETION;
-        new_event.event_time = state.expected_completion;
-        new_event.job.job_id = job_id;
-        new_event.job.p = jobs[job_id].p;
-        event_queue.push(new_event);
-    };
-
-    auto process_allocation_changes = [&](long double current_time) {
-        if(scheduler_type == E) {
-            // EQUI affects all jobs
-            std::vector<std::pair<size_t, double>> output;
-            equi->get_all_allocations(output);
-            for(auto& [job_id, servers] : output) {
-                update_job_processing(job_id, current_time, servers);
-            }
-        } else {
-            // RCGREEDY only affects changed jobs
-            auto changes = rcgreedy->get_server_changes();
-            for(auto& [job_id, servers] : changes) {
-                if(job_states.count(job_id)) {
-                    update_job_processing(job_id, current_time, servers);
-                }
-            }
-        }
-    };
-
-    while(!event_queue.empty()) {
-        auto event = event_queue.top();
-        event_queue.pop();
-        current_time = event.event_time;
-
-        if(event.event_type == ARRIVAL) {
-            // Track arrival time and store job info
-            job_arrival_times[event.job.job_id] = current_time;
-            jobs[event.job.job_id] = event.job;
-            JobState state;
-            state.remaining_size = event.job.size;
-            state.current_speedup = 1.0; // Will be updated immediately
-            state.last_update_time = current_time;
-            state.expected_completion = 0.0; // Will be set soon
-            job_states[event.job.job_id] = state;
-            auto start = std::chrono::high_resolution_clock::now();
-            
-            if(scheduler_type == E) {
-                equi->insert_job(event.job.job_id);
-            } else {
-                RCGREEDY::RCGREEDY_Job job;
-                job.id = event.job.job_id;
-                job.p = event.job.p;
-                
-                if(realloc_counter == 0) {
-                    rcgreedy->full_realloc();
-                    realloc_counter = full_realloc_count;
-                }
-                rcgreedy->add_job(job, true);
-                realloc_counter--;
-            }
-            
-            // Process allocation changes and update all affected jobs
-            process_allocation_changes(current_time);
-
-            auto end = std::chrono::high_resolution_clock::now();
-            total_real_time += std::chrono::duration<double>(end - start).count();
-
-        } else if(event.event_type == COMPLETION) {
-            auto it = job_states.find(event.job.job_id);
-            if(it == job_states.end()) continue;
-            
-            auto& state = it->second;
-            if(std::abs(event.event_time - state.expected_completion) > 1e-6) {
-                continue; // Skip outdated event
-            }
-
-            // Record processing time
-            processing_times.push_back(current_time - job_arrival_times[event.job.job_id]);
-            
-            auto start = std::chrono::high_resolution_clock::now();
-            
-            if(scheduler_type == E) {
-                equi->delete_job(event.job.job_id);
-            } else {
-                RCGREEDY::RCGREEDY_Job job;
-                job.id = event.job.job_id;
-                job.p = event.job.p;
-                
-                if(realloc_counter == 0) {
-                    rcgreedy->full_realloc();
-                    realloc_counter = full_realloc_count;
-                }
-                rcgreedy->delete_job(job, true);
-                realloc_counter--;
-            }
-            
-            // Process allocation changes and update affected jobs
-            process_allocation_changes(current_time);
-            
-            job_states.erase(it);
-            jobs.erase(event.job.job_id);
-            job_arrival_times.erase(event.job.job_id);
-
-            auto end = std::chrono::high_resolution_clock::now();
-            total_real_time += std::chrono::duration<double>(end - start).count();
-        }
-    }
-
-    // Calculate averages
-    long double avg_processing = processing_times.empty() ? 0.0 :
-        std::accumulate(processing_times.begin(), processing_times.end(), 0.0) / processing_times.size();
-        
-    long double avg_real = processing_times.empty() ? 0.0 :
-        total_real_time / processing_times.size();
-
-    return {avg_processing, total_real_time};
-}
\ No newline at end of file
+    int flag = scheduler_type == E ? E : 1 << r_depth;
+    return lockstep_runner(events, {flag}, num_servers, partial_servers,
+                           full_realloc_count, job_size_lambda, options)[0];
+}
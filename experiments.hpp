@@ -1,37 +1,38 @@
 #ifndef EXPERIMENTS_HPP
 #define EXPERIMENTS_HPP
 
-#include "rcgreedy_base.hpp"
-#include "event_generator.hpp"
-#include "equi.hpp"
-#include <chrono>
+#include "simulator.hpp"
+#include "federation.hpp"
 #include <vector>
 #include <utility> // for pair
 #include <memory>
 #include <fstream>
 #include <iomanip>
 #include <algorithm>
-
-struct SimulationResults {
-    long double avg_processing_time;
-    long double avg_real_time;
-};
-
-
-struct JobState {
-    double remaining_size;
-    double current_speedup;
-    long double last_update_time;
-    long double expected_completion;
+#include <functional>
+#include <numeric>
+#include <cmath>
+
+// how many trials are run per parameter value
+struct TrialOptions {
+    double ci_target = 0.0;     // if > 0, keep adding trials until every scheduler's 95% CI half width
+                                // is at most ci_target times its mean processing time
+    size_t max_trials = 100;    // adaptive mode only: stop here even if the target isn't met
+    unsigned seed = 0;          // trial t uses events seeded with seed + t, 0 draws a fresh seed
 };
 
 void write_csv_header(const std::string& filename);
 void write_csv_row(const std::string& filename, const std::string& scheduler, 
                    const std::string& param, long double value, const SimulationResults& results);
-void run_experiment_option(int option, int trials, const std::string& csv_file, int options_to_run);
+// sim_options is the base simulator behaviour, options that sweep a simulator setting override it
+void run_experiment_option(int option, int trials, const std::string& csv_file, int options_to_run,
+                           const TrialOptions& trial_options = TrialOptions(),
+                           const SimulationOptions& base_options = SimulationOptions());
 
 
-void experiments(size_t trials, int option, std::string csv_output_file, bool generate_graphs);
+void experiments(size_t trials, int option, std::string csv_output_file, bool generate_graphs,
+                 const TrialOptions& trial_options = TrialOptions(),
+                 const SimulationOptions& sim_options = SimulationOptions());
 
 
                         // going to need as input flags:
@@ -45,23 +46,14 @@ void experiments(size_t trials, int option, std::string csv_output_file, bool ge
                         //      seperate expirements for different strategies of reallocation with just rcgreedy
                         //      seperate expirements to see how rcgreedy's computation changes over time
 
-const int E = 1;
-const int R1 = 2;
-const int R2 = 4;     // r=2 (2^2)
-const int R3 = 8;     // r=3 (2^3)
-const int R4 = 16;    // r=4 (2^4)
-const int R5 = 32;    // r=5 (2^5)
-const int R6 = 64;    // r=6 (2^6)
-const int R7 = 128;   // r=7 (2^7)
-const int R8 = 256;   // r=8 (2^8)
-const int R9 = 512;
-
-
 std::vector<SimulationResults> experiments_new(int options_to_run, size_t num_servers = 1000, double job_spacing_lambda = 1.0, 
                      double job_size_lambda = 9.0, bool partial_servers = true, 
-                     size_t jobs = 300, size_t full_realloc_count = 1);
+                     size_t jobs = 300, size_t full_realloc_count = 1,
+                     const SimulationOptions& options = SimulationOptions(), unsigned seed = 0,
+                     double p_min = 0.0, double p_max = 1.0);
 
 
+// runs a single scheduler over events, see lockstep_runner to compare several at once
 SimulationResults simulation_runner(
     boost::heap::priority_queue<Event, boost::heap::compare<Compare_Event>>& events,
     int scheduler_type,
@@ -69,7 +61,8 @@ SimulationResults simulation_runner(
     bool partial_servers,
     int r_depth = 0, 
     size_t full_realloc_count = 10,
-    double job_size_lambda = 1.0
+    double job_size_lambda = 1.0,
+    const SimulationOptions& options = SimulationOptions()
 );
 
 
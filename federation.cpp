@@ -0,0 +1,432 @@
+#include "federation.hpp"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <thread>
+
+size_t choose_pool(const std::vector<Pool_Stats>& pools, double p, size_t choices, std::mt19937& generator) {
+    // a is a better home for the job than b
+    auto better = [&](size_t a, size_t b) {
+        double load_a = (pools[a].jobs + 1.0) / std::max<size_t>(pools[a].servers, 1);
+        double load_b = (pools[b].jobs + 1.0) / std::max<size_t>(pools[b].servers, 1);
+        if(load_a != load_b) return load_a < load_b;
+        double distance_a = pools[a].jobs ? std::abs(pools[a].mean_p() - p) : 0.0;
+        double distance_b = pools[b].jobs ? std::abs(pools[b].mean_p() - p) : 0.0;
+        return distance_a < distance_b;
+    };
+
+    size_t best = 0;
+    if(choices >= pools.size()) {
+        for(size_t pool = 1; pool < pools.size(); pool++) {
+            if(better(pool, best)) best = pool;
+        }
+        return best;
+    }
+
+    std::uniform_int_distribution<size_t> pick(0, pools.size() - 1);
+    best = pick(generator);
+    for(size_t i = 1; i < choices; i++) {
+        size_t pool = pick(generator);
+        if(better(pool, best)) best = pool;
+    }
+    return best;
+}
+
+std::vector<Pool_Transfer> plan_rebalance(const std::vector<Pool_Stats>& pools, double tolerance) {
+    size_t total_jobs = 0, total_servers = 0;
+    for(const auto& pool : pools) {
+        total_jobs += pool.jobs;
+        total_servers += pool.servers;
+    }
+    std::vector<Pool_Transfer> transfers;
+    if(!total_servers) return transfers;
+
+    // (jobs over or under the share, pool)
+    std::vector<std::pair<size_t, size_t>> donors, receivers;
+    for(size_t i = 0; i < pools.size(); i++) {
+        double share = static_cast<double>(total_jobs) * pools[i].servers / total_servers;
+        double excess = pools[i].jobs - share;
+        if(excess > std::max(1.0, tolerance * share)) {
+            donors.push_back({static_cast<size_t>(excess), i});
+        } else if(excess <= -1.0) {
+            receivers.push_back({static_cast<size_t>(-excess), i});
+        }
+    }
+    auto largest_first = [](const std::pair<size_t, size_t>& a, const std::pair<size_t, size_t>& b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    };
+    std::sort(donors.begin(), donors.end(), largest_first);
+    std::sort(receivers.begin(), receivers.end(), largest_first);
+
+    size_t d = 0, r = 0;
+    while(d < donors.size() && r < receivers.size()) {
+        size_t count = std::min(donors[d].first, receivers[r].first);
+        transfers.push_back({donors[d].second, receivers[r].second, count});
+        donors[d].first -= count;
+        receivers[r].first -= count;
+        if(!donors[d].first) d++;
+        if(!receivers[r].first) r++;
+    }
+    return transfers;
+}
+
+bool give_highest_p(const std::vector<Pool_Stats>& pools, size_t pool) {
+    size_t total_jobs = 0;
+    double total_p = 0.0;
+    for(const auto& stats : pools) {
+        total_jobs += stats.jobs;
+        total_p += stats.total_p;
+    }
+    return total_jobs && pools[pool].mean_p() > total_p / total_jobs;
+}
+
+
+Federation::Federation(const std::vector<size_t>& pool_servers, size_t max_depth, double average_size,
+                       bool partial_server_allocs, size_t choices, unsigned seed)
+    : stats(pool_servers.size()), pool_jobs(pool_servers.size()), choices(choices), generator(seed) {
+    for(size_t i = 0; i < pool_servers.size(); i++) {
+        pools.push_back(std::make_unique<RCGREEDY>(pool_servers[i], max_depth, average_size, partial_server_allocs));
+        stats[i].servers = pool_servers[i];
+    }
+}
+
+size_t Federation::add_job(RCGREEDY::RCGREEDY_Job &job, bool forced_local_realloc) {
+    changes.clear();
+    if(job_pool.count(job.id)) {
+        std::cerr << "Error adding job " << job.id << ". Job already exists" << std::endl;
+        return job_pool[job.id].first;
+    }
+    size_t pool = choose_pool(stats, job.p, choices, generator);
+    insert(pool, job, forced_local_realloc);
+    return pool;
+}
+
+void Federation::delete_job(RCGREEDY::RCGREEDY_Job &job, bool forced_local_realloc) {
+    changes.clear();
+    auto it = job_pool.find(job.id);
+    if(it == job_pool.end()) {
+        std::cerr << "Error deleting job " << job.id << ". Job doesn't exist." << std::endl;
+        return;
+    }
+    erase(it->second.first, job, forced_local_realloc);
+}
+
+size_t Federation::rebalance(double tolerance) {
+    changes.clear();
+    std::vector<Pool_Transfer> transfers = plan_rebalance(stats, tolerance);
+
+    // each donor's direction is fixed before any of its jobs leave
+    std::vector<bool> highest(pools.size());
+    for(size_t pool = 0; pool < pools.size(); pool++) highest[pool] = give_highest_p(stats, pool);
+
+    size_t moved = 0;
+    for(const auto& transfer : transfers) {
+        auto& jobs = pool_jobs[transfer.from];
+        for(size_t i = 0; i < transfer.count && !jobs.empty(); i++) {
+            auto it = highest[transfer.from] ? std::prev(jobs.end()) : jobs.begin();
+            RCGREEDY::RCGREEDY_Job job;
+            job.id = it->second;
+            job.p = it->first;
+            erase(transfer.from, job, true);
+            insert(transfer.to, job, true);
+            moved += 1;
+        }
+    }
+    return moved;
+}
+
+size_t Federation::get_job_pool(size_t job_id) const {
+    return job_pool.at(job_id).first;
+}
+
+size_t Federation::get_pool_count() const {
+    return pools.size();
+}
+
+RCGREEDY& Federation::get_pool(size_t pool) {
+    return *pools[pool];
+}
+
+const std::vector<Pool_Stats>& Federation::get_stats() const {
+    return stats;
+}
+
+const std::vector<std::pair<size_t, double>>& Federation::get_server_changes() const {
+    return changes;
+}
+
+void Federation::insert(size_t pool, RCGREEDY::RCGREEDY_Job &job, bool forced_local_realloc) {
+    pools[pool]->add_job(job, forced_local_realloc);
+    stats[pool].jobs += 1;
+    stats[pool].total_p += job.p;
+    pool_jobs[pool].insert({job.p, job.id});
+    job_pool[job.id] = {pool, job.p};
+
+    const auto& pool_changes = pools[pool]->get_server_changes();
+    changes.insert(changes.end(), pool_changes.begin(), pool_changes.end());
+}
+
+void Federation::erase(size_t pool, RCGREEDY::RCGREEDY_Job &job, bool forced_local_realloc) {
+    double p = job_pool[job.id].second;
+    pools[pool]->delete_job(job, forced_local_realloc);
+    stats[pool].jobs -= 1;
+    stats[pool].total_p -= p;
+    pool_jobs[pool].erase({p, job.id});
+    job_pool.erase(job.id);
+
+    const auto& pool_changes = pools[pool]->get_server_changes();
+    changes.insert(changes.end(), pool_changes.begin(), pool_changes.end());
+}
+
+
+Local_Transport::Local_Transport(size_t endpoints) : mailboxes(endpoints) {}
+
+void Local_Transport::send(size_t to, Federation_Message message) {
+    Mailbox& mailbox = mailboxes[to];
+    {
+        std::lock_guard<std::mutex> guard(mailbox.lock);
+        mailbox.messages.push_back(std::move(message));
+    }
+    mailbox.ready.notify_one();
+}
+
+Federation_Message Local_Transport::receive(size_t endpoint) {
+    Mailbox& mailbox = mailboxes[endpoint];
+    std::unique_lock<std::mutex> guard(mailbox.lock);
+    mailbox.ready.wait(guard, [&] { return !mailbox.messages.empty(); });
+    Federation_Message message = std::move(mailbox.messages.front());
+    mailbox.messages.pop_front();
+    return message;
+}
+
+
+// the stats of a simulated pool, with p as known to its scheduler
+static Pool_Stats sim_stats(const Scheduler_Sim& sim, size_t servers) {
+    Pool_Stats stats;
+    stats.servers = servers;
+    for(const auto& [job_id, state] : sim.jobs()) {
+        stats.jobs += 1;
+        stats.total_p += state.p_estimate;
+    }
+    return stats;
+}
+
+// the thread of one pool in federated_runner, answers the coordinator until told to stop
+static void pool_loop(Scheduler_Sim& sim, const std::vector<Event>& arrivals, Local_Transport& transport,
+                      size_t pool, size_t servers, size_t coordinator) {
+    const long double infinity = std::numeric_limits<long double>::infinity();
+    while(true) {
+        Federation_Message message = transport.receive(pool);
+        Federation_Message reply;
+        reply.from = pool;
+
+        switch(message.type) {
+            case Federation_Message::RUN_EPOCH: {
+                for(size_t arrival : message.arrivals) {
+                    while(sim.next_completion() < arrivals[arrival].event_time) sim.complete();
+                    sim.arrive(arrival);
+                }
+                while(sim.next_completion() < message.time) sim.complete();
+                reply.type = Federation_Message::STATS;
+                reply.stats = sim_stats(sim, servers);
+                break;
+            }
+            case Federation_Message::EVICT: {
+                // ordered by (p, id) so the choice doesn't depend on the job table's layout
+                std::vector<std::pair<double, size_t>> order;
+                for(const auto& [job_id, state] : sim.jobs()) order.push_back({state.p_estimate, job_id});
+                size_t count = std::min(message.count, order.size());
+                if(message.highest_p) {
+                    std::partial_sort(order.begin(), order.begin() + count, order.end(), std::greater<>());
+                } else {
+                    std::partial_sort(order.begin(), order.begin() + count, order.end());
+                }
+                for(size_t i = 0; i < count; i++) {
+                    reply.jobs.push_back({order[i].second, sim.evict(order[i].second, message.time)});
+                }
+                reply.type = Federation_Message::JOBS;
+                reply.stats = sim_stats(sim, servers);
+                break;
+            }
+            case Federation_Message::ADMIT: {
+                for(const auto& [job_id, state] : message.jobs) sim.admit(job_id, state, message.time);
+                reply.type = Federation_Message::DONE;
+                reply.stats = sim_stats(sim, servers);
+                break;
+            }
+            case Federation_Message::DRAIN: {
+                while(sim.next_completion() != infinity) sim.complete();
+                reply.type = Federation_Message::RESULTS;
+                reply.results = sim.results();
+                break;
+            }
+            case Federation_Message::STOP:
+                return;
+            default:
+                std::cerr << "Error, pool " << pool << " received an unexpected message" << std::endl;
+                reply.type = Federation_Message::DONE;
+                break;
+        }
+        transport.send(coordinator, std::move(reply));
+    }
+}
+
+SimulationResults federated_runner(
+    const boost::heap::priority_queue<Event, boost::heap::compare<Compare_Event>>& events,
+    int scheduler_type,
+    size_t num_servers,
+    bool partial_servers,
+    size_t full_realloc_count,
+    double job_size_lambda,
+    const SimulationOptions& options
+) {
+    auto event_queue = events;
+    std::vector<Event> arrivals;
+    arrivals.reserve(event_queue.size());
+    while(!event_queue.empty()) {
+        arrivals.push_back(event_queue.top());
+        event_queue.pop();
+    }
+
+    if(options.capacity_amplitude > 0) {
+        std::cerr << "Error, federated runs don't support capacity changes, the server count stays fixed" << std::endl;
+    }
+
+    const size_t pool_count = std::max<size_t>(options.pools, 1);
+    const size_t coordinator = pool_count;
+    int depth = scheduler_type == E ? 0 : __builtin_ctz(scheduler_type);
+
+    std::vector<Pool_Stats> stats(pool_count);
+    std::vector<std::unique_ptr<Scheduler_Sim>> sims;
+    for(size_t pool = 0; pool < pool_count; pool++) {
+        stats[pool].servers = num_servers / pool_count + (pool < num_servers % pool_count);
+        sims.push_back(std::make_unique<Scheduler_Sim>(arrivals, scheduler_type, stats[pool].servers, partial_servers,
+                                                       depth, full_realloc_count, job_size_lambda, options));
+    }
+
+    auto wall_start = std::chrono::high_resolution_clock::now();
+    Local_Transport transport(pool_count + 1);
+    std::vector<std::thread> threads;
+    for(size_t pool = 0; pool < pool_count; pool++) {
+        threads.emplace_back(pool_loop, std::ref(*sims[pool]), std::cref(arrivals), std::ref(transport),
+                             pool, stats[pool].servers, coordinator);
+    }
+
+    auto make_message = [](Federation_Message::Type type, long double time) {
+        Federation_Message message;
+        message.type = type;
+        message.time = time;
+        return message;
+    };
+
+    // replies to one request per pool, in any order
+    auto collect = [&](size_t replies, std::vector<Federation_Message>& into) {
+        for(size_t i = 0; i < replies; i++) {
+            Federation_Message reply = transport.receive(coordinator);
+            size_t from = reply.from;
+            into[from] = std::move(reply);
+        }
+    };
+
+    // the router only knows p as the schedulers do
+    bool known_p = !options.estimate_p || scheduler_type == E;
+    std::mt19937 generator(1);
+    size_t migrations = 0;
+    size_t next = 0;
+    for(size_t epoch = 0; next < arrivals.size(); epoch++) {
+        long double end = options.rebalance_epoch > 0 ? (epoch + 1) * static_cast<long double>(options.rebalance_epoch)
+                                                      : std::numeric_limits<long double>::infinity();
+
+        std::vector<Federation_Message> runs(pool_count, make_message(Federation_Message::RUN_EPOCH, end));
+        for(; next < arrivals.size() && arrivals[next].event_time < end; next++) {
+            double p = known_p ? arrivals[next].job.p : options.p_prior;
+            size_t pool = choose_pool(stats, p, options.pool_choices, generator);
+            stats[pool].jobs += 1;
+            stats[pool].total_p += p;
+            runs[pool].arrivals.push_back(next);
+        }
+        for(size_t pool = 0; pool < pool_count; pool++) transport.send(pool, std::move(runs[pool]));
+
+        std::vector<Federation_Message> replies(pool_count);
+        collect(pool_count, replies);
+        for(size_t pool = 0; pool < pool_count; pool++) stats[pool] = replies[pool].stats;
+
+        std::vector<Pool_Transfer> transfers = plan_rebalance(stats, options.rebalance_tolerance);
+        if(transfers.empty()) continue;
+
+        // every donor evicts all it gives away at once, in the direction set by the stats before the moves
+        std::vector<size_t> give(pool_count, 0);
+        for(const auto& transfer : transfers) give[transfer.from] += transfer.count;
+        size_t donors = 0;
+        for(size_t pool = 0; pool < pool_count; pool++) {
+            if(!give[pool]) continue;
+            Federation_Message evict = make_message(Federation_Message::EVICT, end);
+            evict.count = give[pool];
+            evict.highest_p = give_highest_p(stats, pool);
+            transport.send(pool, std::move(evict));
+            donors += 1;
+        }
+        collect(donors, replies);
+
+        std::vector<Federation_Message> admits(pool_count, make_message(Federation_Message::ADMIT, end));
+        std::vector<size_t> taken(pool_count, 0);
+        for(const auto& transfer : transfers) {
+            auto& evicted = replies[transfer.from].jobs;
+            for(size_t i = 0; i < transfer.count && taken[transfer.from] < evicted.size(); i++) {
+                admits[transfer.to].jobs.push_back(evicted[taken[transfer.from]++]);
+            }
+        }
+        for(size_t pool = 0; pool < pool_count; pool++) {
+            if(give[pool]) stats[pool] = replies[pool].stats;
+        }
+
+        std::vector<bool> receiving(pool_count, false);
+        size_t receivers = 0;
+        for(size_t pool = 0; pool < pool_count; pool++) {
+            if(admits[pool].jobs.empty()) continue;
+            migrations += admits[pool].jobs.size();
+            transport.send(pool, std::move(admits[pool]));
+            receiving[pool] = true;
+            receivers += 1;
+        }
+        collect(receivers, replies);
+        for(size_t pool = 0; pool < pool_count; pool++) {
+            if(receiving[pool]) stats[pool] = replies[pool].stats;
+        }
+    }
+
+    std::vector<Federation_Message> drained(pool_count);
+    for(size_t pool = 0; pool < pool_count; pool++) transport.send(pool, make_message(Federation_Message::DRAIN, 0.0));
+    collect(pool_count, drained);
+    for(size_t pool = 0; pool < pool_count; pool++) transport.send(pool, make_message(Federation_Message::STOP, 0.0));
+    for(auto& thread : threads) thread.join();
+    auto wall_end = std::chrono::high_resolution_clock::now();
+
+    // pool averages weighted by the jobs behind them
+    SimulationResults combined{0.0, 0.0, 0.0};
+    size_t finished = 0;
+    for(const auto& reply : drained) {
+        const SimulationResults& results = reply.results;
+        size_t pool_finished = results.completed_jobs + results.warmup_jobs;
+        combined.avg_processing_time += results.avg_processing_time * results.completed_jobs;
+        combined.completed_jobs += results.completed_jobs;
+        combined.avg_real_time += results.avg_real_time;
+        combined.max_event_time = std::max(combined.max_event_time, results.max_event_time);
+        combined.warmup_jobs += results.warmup_jobs;
+        combined.server_moves += results.server_moves;
+        combined.p_error += results.p_error * pool_finished;
+        combined.p_observations += results.p_observations * pool_finished;
+        combined.effective_depth += results.effective_depth * pool_finished;
+        finished += pool_finished;
+    }
+    if(combined.completed_jobs) combined.avg_processing_time /= combined.completed_jobs;
+    if(finished) {
+        combined.p_error /= finished;
+        combined.p_observations /= finished;
+        combined.effective_depth /= finished;
+    }
+    combined.migrations = migrations;
+    combined.wall_time = std::chrono::duration<double>(wall_end - wall_start).count();
+    return combined;
+}
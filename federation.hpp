@@ -0,0 +1,181 @@
+#ifndef FEDERATION_HPP
+#define FEDERATION_HPP
+
+#include "rcgreedy_base.hpp"
+#include "simulator.hpp"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// the aggregate statistics a pool reports to the rest of the federation
+struct Pool_Stats {
+    size_t servers = 0;
+    size_t jobs = 0;
+    double total_p = 0.0;   // sum of the p of its jobs, as known to its scheduler
+
+    double mean_p() const { return jobs ? total_p / jobs : 0.0; }
+};
+
+// count jobs to move from pool `from` to pool `to`
+struct Pool_Transfer {
+    size_t from;
+    size_t to;
+    size_t count;
+};
+
+/*
+* power of d choices: samples choices pools (with replacement, or takes every pool if choices
+* is at least the pool count) and returns the one with the fewest jobs per server after adding
+* a job, ties going to the pool whose mean p is closest to p
+*/
+size_t choose_pool(const std::vector<Pool_Stats>& pools, double p, size_t choices, std::mt19937& generator);
+
+/*
+* every pool's share of the jobs is proportional to its servers. Pools more than tolerance
+* times their share (and at least one job) over it give their excess to the pools under their
+* share, largest excess first. Returns the moves, which leave every pool within one job of its
+* share where the excess allows
+*/
+std::vector<Pool_Transfer> plan_rebalance(const std::vector<Pool_Stats>& pools, double tolerance);
+
+/*
+* whether a pool giving away jobs should send its highest p jobs, which moves its mean p
+* toward the federation's when it is above it, or its lowest
+*/
+bool give_highest_p(const std::vector<Pool_Stats>& pools, size_t pool);
+
+
+/*
+* several RCGREEDY instances (racks or clusters, each with its own servers) behind one
+* scheduler interface. Jobs are routed to a pool on arrival with choose_pool, and rebalance
+* moves jobs between pools with plan_rebalance. Job ids must be unique over the federation
+*/
+class Federation {
+public:
+    /*
+    * one pool per entry of pool_servers, the rest is passed to every RCGREEDY instance.
+    * seed drives the pool sampling of the routing
+    */
+    Federation(const std::vector<size_t>& pool_servers, size_t max_depth, double average_size,
+               bool partial_server_allocs = false, size_t choices = 2, unsigned seed = 1);
+
+    /*
+    * routes the job to a pool and adds it there, returning the pool
+    */
+    size_t add_job(RCGREEDY::RCGREEDY_Job &job, bool forced_local_realloc);
+
+    /*
+    * deletes the job from its pool
+    */
+    void delete_job(RCGREEDY::RCGREEDY_Job &job, bool forced_local_realloc);
+
+    /*
+    * moves jobs between pools as planned by plan_rebalance with tolerance, returning how
+    * many moved. Donors give away the jobs that pull their mean p toward the federation's
+    */
+    size_t rebalance(double tolerance);
+
+    // returns the pool holding the job, which must be in the federation
+    size_t get_job_pool(size_t job_id) const;
+
+    size_t get_pool_count() const;
+    RCGREEDY& get_pool(size_t pool);
+    const std::vector<Pool_Stats>& get_stats() const;
+
+    /*
+    * returns the (job id, servers) changes of the last add_job, delete_job or rebalance over
+    * every pool it touched. A moved job only appears with its new pool's allocation
+    */
+    const std::vector<std::pair<size_t, double>>& get_server_changes() const;
+
+private:
+    std::vector<std::unique_ptr<RCGREEDY>> pools;
+    std::vector<Pool_Stats> stats;
+    std::vector<std::set<std::pair<double, size_t>>> pool_jobs;    // (p, id) of the jobs in each pool
+    std::unordered_map<size_t, std::pair<size_t, double>> job_pool;  // id to (pool, p)
+    size_t choices;
+    std::mt19937 generator;
+    std::vector<std::pair<size_t, double>> changes;
+
+    void insert(size_t pool, RCGREEDY::RCGREEDY_Job &job, bool forced_local_realloc);
+    void erase(size_t pool, RCGREEDY::RCGREEDY_Job &job, bool forced_local_realloc);
+};
+
+
+/*
+* a message between the federation coordinator and a pool in federated_runner
+*/
+struct Federation_Message {
+    enum Type {
+        RUN_EPOCH,  // to a pool: arrive arrivals and finish every job due before time, reply STATS
+        STATS,      // from a pool: its stats at the end of the epoch
+        EVICT,      // to a pool: remove count jobs at time, highest or lowest p first, reply JOBS
+        JOBS,       // from a pool: the evicted jobs
+        ADMIT,      // to a pool: add jobs at time, reply DONE
+        DRAIN,      // to a pool: finish every job, reply RESULTS
+        RESULTS,    // from a pool: its simulation results
+        DONE,
+        STOP        // to a pool: exit its thread
+    };
+
+    Type type = DONE;
+    size_t from = 0;
+    long double time = 0.0;
+    std::vector<size_t> arrivals;
+    size_t count = 0;
+    bool highest_p = false;
+    std::vector<std::pair<size_t, JobState>> jobs;
+    Pool_Stats stats;
+    SimulationResults results{};
+};
+
+/*
+* in process stand-in for the network between the coordinator and the pools: one blocking
+* mailbox per endpoint, messages from one sender to one endpoint arrive in order
+*/
+class Local_Transport {
+public:
+    explicit Local_Transport(size_t endpoints);
+
+    void send(size_t to, Federation_Message message);
+
+    // waits for the next message to endpoint
+    Federation_Message receive(size_t endpoint);
+
+private:
+    struct Mailbox {
+        std::mutex lock;
+        std::condition_variable ready;
+        std::deque<Federation_Message> messages;
+    };
+    std::vector<Mailbox> mailboxes;
+};
+
+
+/*
+* runs one scheduler (E or an RCGREEDY flag) as options.pools pools splitting num_servers,
+* each a Scheduler_Sim on its own thread. The coordinator (the calling thread) routes the
+* arrivals of every rebalance_epoch with choose_pool, on the stats of the last epoch plus the
+* jobs it routed since, then collects stats over a Local_Transport and moves jobs with
+* plan_rebalance at the end of the epoch. Results are combined over the pools, weighted by
+* completed jobs, and warm-up is deleted per pool. Scheduling times are summed over pools,
+* wall_time is the time the whole run took
+*/
+SimulationResults federated_runner(
+    const boost::heap::priority_queue<Event, boost::heap::compare<Compare_Event>>& events,
+    int scheduler_type,
+    size_t num_servers,
+    bool partial_servers,
+    size_t full_realloc_count = 10,
+    double job_size_lambda = 1.0,
+    const SimulationOptions& options = SimulationOptions()
+);
+
+
+#endif // FEDERATION_HPP
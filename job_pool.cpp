@@ -0,0 +1,193 @@
+#include "job_pool.hpp"
+#include <cstring>
+
+Job_Pool::Job_Pool() {
+    rehash(16);
+}
+
+void Job_Pool::reserve(size_t job_capacity) {
+    records.reserve(job_capacity);
+
+    // keep the load factor at or below 1/2
+    if (job_capacity * 2 > table.size()) rehash(job_capacity * 2);
+}
+
+uint32_t Job_Pool::find(size_t id) const {
+    for (size_t i = bucket(id); table[i].slot != NONE; i = (i + 1) & table_mask) {
+        if (table[i].id == id) return table[i].slot;
+    }
+    return NONE;
+}
+
+uint32_t Job_Pool::insert(size_t id, double p) {
+    if ((live_jobs + 1) * 2 > table.size()) rehash(table.size() * 2);
+
+    // reuse a recycled record if there is one
+    uint32_t slot;
+    if (free_head != NONE) {
+        slot = free_head;
+        free_head = records[slot].next;
+    } else {
+        slot = static_cast<uint32_t>(records.size());
+        records.emplace_back();
+    }
+    records[slot].id = id;
+    records[slot].p = p;
+    records[slot].waiting = false;
+    records[slot].prev = NONE;
+    records[slot].next = NONE;
+
+    size_t i = bucket(id);
+    while (table[i].slot != NONE) i = (i + 1) & table_mask;
+    table[i] = Entry{id, slot};
+    live_jobs += 1;
+
+    return slot;
+}
+
+void Job_Pool::erase(uint32_t slot) {
+    size_t i = bucket(records[slot].id);
+    while (table[i].slot != slot) i = (i + 1) & table_mask;
+
+    // backward shift deletion, so probe sequences never need tombstones
+    size_t j = i;
+    while (true) {
+        j = (j + 1) & table_mask;
+        if (table[j].slot == NONE) break;
+
+        // move entry j into the hole if the hole lies on its probe sequence
+        size_t home = bucket(table[j].id);
+        if (((j - home) & table_mask) >= ((j - i) & table_mask)) {
+            table[i] = table[j];
+            i = j;
+        }
+    }
+    table[i].slot = NONE;
+    live_jobs -= 1;
+
+    records[slot].next = free_head;
+    free_head = slot;
+}
+
+size_t Job_Pool::memory_footprint() const {
+    return records.capacity() * sizeof(Record) + table.capacity() * sizeof(Entry);
+}
+
+void Job_Pool::write_image(Image_Writer &writer) const {
+    writer.put_vector(records);
+    writer.put(free_head);
+    writer.put_vector(table);
+    writer.put<uint64_t>(live_jobs);
+}
+
+bool Job_Pool::read_image(Image_Reader &reader) {
+    uint64_t live = 0;
+    reader.get_vector(records);
+    reader.get(free_head);
+    reader.get_vector(table);
+    reader.get(live);
+    live_jobs = live;
+    table_mask = table.size() - 1;
+
+    // the table must leave empty entries to end every probe, as insert keeps it at most half full
+    bool power_of_two = !table.empty() && (table.size() & table_mask) == 0;
+    if (!reader.good() || !power_of_two || live_jobs > records.size() || live_jobs * 2 > table.size()) return false;
+
+    // every slot in the table and the free list is checked against the restored records, and
+    // every record is either live (reachable from its bucket) or free, never both
+    std::vector<char> used(records.size(), 0);
+    size_t entries = 0;
+    for (size_t i = 0; i < table.size(); ++i) {
+        uint32_t slot = table[i].slot;
+        if (slot == NONE) continue;
+        if (slot >= records.size() || used[slot] || records[slot].id != table[i].id) return false;
+        for (size_t j = bucket(table[i].id); j != i; j = (j + 1) & table_mask) {
+            if (table[j].slot == NONE) return false;
+        }
+        used[slot] = 1;
+        entries += 1;
+    }
+    size_t free_records = 0;
+    for (uint32_t slot = free_head; slot != NONE; slot = records[slot].next) {
+        if (slot >= records.size() || used[slot]) return false;
+        used[slot] = 1;
+        free_records += 1;
+    }
+    if (entries != live_jobs || entries + free_records != records.size()) return false;
+    for (const Record &record : records) {
+        unsigned char waiting;
+        std::memcpy(&waiting, &record.waiting, 1);     // a bool read from the image may hold any byte
+        if ((record.prev != NONE && record.prev >= records.size()) || (record.next != NONE && record.next >= records.size())
+            || waiting > 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Job_Pool::check_list(const List &list, std::vector<char> &seen) const {
+    seen.resize(records.size(), 0);
+    size_t count = 0;
+    uint32_t prev = NONE;
+    for (uint32_t slot = list.head; slot != NONE; slot = records[slot].next) {
+        if (slot >= records.size() || seen[slot] || records[slot].prev != prev || find(records[slot].id) != slot) {
+            return false;
+        }
+        seen[slot] = 1;
+        prev = slot;
+        count += 1;
+    }
+    return list.tail == prev && list.size == count;
+}
+
+void Job_Pool::link(List &list, uint32_t slot) {
+    records[slot].prev = NONE;
+    records[slot].next = list.head;
+    if (list.head != NONE) records[list.head].prev = slot;
+    if (list.tail == NONE) list.tail = slot;
+    list.head = slot;
+    list.size += 1;
+}
+
+void Job_Pool::link_back(List &list, uint32_t slot) {
+    records[slot].prev = list.tail;
+    records[slot].next = NONE;
+    if (list.tail != NONE) records[list.tail].next = slot;
+    if (list.head == NONE) list.head = slot;
+    list.tail = slot;
+    list.size += 1;
+}
+
+void Job_Pool::unlink(List &list, uint32_t slot) {
+    Record &record = records[slot];
+    if (record.prev != NONE) {
+        records[record.prev].next = record.next;
+    } else {
+        list.head = record.next;
+    }
+    if (record.next != NONE) {
+        records[record.next].prev = record.prev;
+    } else {
+        list.tail = record.prev;
+    }
+    record.prev = NONE;
+    record.next = NONE;
+    list.size -= 1;
+}
+
+void Job_Pool::rehash(size_t new_size) {
+    size_t size = 16;
+    while (size < new_size) size *= 2;
+
+    std::vector<Entry> old_table;
+    old_table.swap(table);
+    table.assign(size, Entry{});
+    table_mask = size - 1;
+
+    for (const Entry &entry : old_table) {
+        if (entry.slot == NONE) continue;
+        size_t i = bucket(entry.id);
+        while (table[i].slot != NONE) i = (i + 1) & table_mask;
+        table[i] = entry;
+    }
+}
@@ -0,0 +1,102 @@
+#ifndef JOB_POOL_HPP
+#define JOB_POOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include "snapshot_image.hpp"
+#include <vector>
+
+/*
+* pooled storage for the jobs of a scheduler. Job records live in a single vector and
+* are recycled through a free list, groups keep intrusive doubly linked lists of their
+* records, and records are found by job id through an open addressing table. Once the
+* pool has held its peak number of jobs (or reserve was called with that capacity),
+* inserting and erasing jobs performs no heap allocations
+*/
+class Job_Pool {
+public:
+    static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+    struct Record {
+        size_t id = 0;
+        double p = 0.0;
+        uint32_t leaf = 0;          // index of the lowest level group holding the job
+        bool waiting = false;       // held in its leaf's admission queue rather than its group list
+        uint32_t prev = NONE;       // neighbours in the group list, next doubles as the free list link
+        uint32_t next = NONE;
+    };
+
+    // intrusive list of the records in one group
+    struct List {
+        uint32_t head = NONE;
+        uint32_t tail = NONE;
+        size_t size = 0;
+    };
+
+    Job_Pool();
+
+    // preallocates records and table entries for job_capacity live jobs
+    void reserve(size_t job_capacity);
+
+    // returns the slot of the job with the given id, or NONE if it isn't stored
+    uint32_t find(size_t id) const;
+
+    // stores a new job and returns its slot. The id must not already be stored
+    uint32_t insert(size_t id, double p);
+
+    // removes the job in slot from the table and recycles the record. The record
+    // must already be unlinked from its group list
+    void erase(uint32_t slot);
+
+    // adds the record in slot to the front / back of list, or removes it from list
+    void link(List &list, uint32_t slot);
+    void link_back(List &list, uint32_t slot);
+    void unlink(List &list, uint32_t slot);
+
+    Record &operator[](uint32_t slot) { return records[slot]; }
+    const Record &operator[](uint32_t slot) const { return records[slot]; }
+
+    // number of live jobs
+    size_t size() const { return live_jobs; }
+
+    // bytes of heap storage held by the pool
+    size_t memory_footprint() const;
+
+    // appends the records, free list and id table as they are to an image
+    void write_image(Image_Writer &writer) const;
+
+    // adopts them back from an image. Returns false if the image doesn't hold a consistent pool:
+    // a slot outside the records, a record both live and free, or an entry its probe can't reach
+    bool read_image(Image_Reader &reader);
+
+    /*
+    * returns true if list links live records only, with prev, tail and size matching its next
+    * links, and none of them is marked in seen. Marks them. Used to check restored lists before
+    * they are walked, seen is sized to the records
+    */
+    bool check_list(const List &list, std::vector<char> &seen) const;
+
+private:
+    struct Entry {
+        size_t id = 0;
+        uint32_t slot = NONE;       // NONE marks an empty entry
+    };
+
+    std::vector<Record> records;
+    uint32_t free_head = NONE;      // first recycled record
+
+    std::vector<Entry> table;       // open addressing with linear probing, size is a power of two
+    size_t table_mask = 0;
+    size_t live_jobs = 0;
+
+    // home bucket of an id (fibonacci hashing, ids are often sequential)
+    inline size_t bucket(size_t id) const {
+        return (id * 11400714819323198485ull) >> 32 & table_mask;
+    }
+
+    // rebuilds the table with at least new_size entries
+    void rehash(size_t new_size);
+};
+
+#endif // JOB_POOL_HPP
@@ -1,6 +1,9 @@
 
 #include "unit_tests.hpp"
 #include "experiments.hpp"
+#include "benchmarks.hpp"
+#include "scheduler_service.hpp"
+#include "differential_fuzz.hpp"
 
 
 // Helper function prototypes
@@ -43,6 +46,10 @@ int main(int argc, char* argv[]) {
     if (argc < 2) {
         std::cerr << "Usage:\n"
                   << "  " << argv[0] << " 0\n"
+                  << "  " << argv[0] << " 2\n"
+                  << "  " << argv[0] << " 3 [service options]  (scheduler daemon)\n"
+                  << "  " << argv[0] << " 4 [service options]  (load generator)\n"
+                  << "  " << argv[0] << " 5 [--seconds s] [--cases n] [--seed n] [--max-ops n]  (differential fuzzing)\n"
                   << "  " << argv[0] << " <flag> [experiment options]\n";
         return 1;
     }
@@ -52,6 +59,59 @@ int main(int argc, char* argv[]) {
         unit_tests();
         return 0;
     }
+    if (main_flag == 2) {
+        return benchmarks();
+    }
+    if (main_flag == 3 || main_flag == 4) {
+        std::vector<std::string> args(argv + 2, argv + argc);
+        Service_Options service_options;
+        get_arg(args, "--name", service_options.name);
+        get_arg(args, "--clients", service_options.clients);
+        get_arg(args, "--socket", service_options.use_socket);
+        get_arg(args, "--ring-capacity", service_options.ring_capacity);
+        get_arg(args, "--servers", service_options.servers);
+        get_arg(args, "--depth", service_options.depth);
+        get_arg(args, "--partial", service_options.partial_servers);
+        get_arg(args, "--full-realloc", service_options.full_realloc_count);
+        get_arg(args, "--client-timeout", service_options.client_timeout);
+        get_arg(args, "--client", service_options.client);
+        get_arg(args, "--jobs", service_options.jobs);
+        get_arg(args, "--batch", service_options.batch);
+        get_arg(args, "--arrival-lambda", service_options.arrival_lambda);
+        get_arg(args, "--job-size-lambda", service_options.job_size_lambda);
+        get_arg(args, "--seed", service_options.seed);
+        get_arg(args, "--query-every", service_options.query_every);
+        if (!args.empty()) {
+            std::cerr << "Error, unknown service option " << args[0] << "\n"
+                      << "Service options (daemon and load generator must agree on the first four):\n"
+                      << "  --name <ring and socket name>  --clients <number>  --socket <true/false>\n"
+                      << "  --ring-capacity <messages>\n"
+                      << "Daemon: --servers <number>  --depth <number>  --partial <true/false>\n"
+                      << "  --full-realloc <requests between full reallocations, 0 = never>\n"
+                      << "  --client-timeout <seconds a client may leave responses unread, 0 = forever>\n"
+                      << "Load generator: --client <index>  --jobs <number>  --batch <requests>\n"
+                      << "  --arrival-lambda <rate>  --job-size-lambda <rate>  --seed <number>\n"
+                      << "  --query-every <adds between queries>\n";
+            return 1;
+        }
+        return main_flag == 3 ? run_daemon(service_options) : run_loadgen(service_options);
+    }
+
+    if (main_flag == 5) {
+        std::vector<std::string> args(argv + 2, argv + argc);
+        Fuzz_Options fuzz_options;
+        get_arg(args, "--seconds", fuzz_options.seconds);
+        get_arg(args, "--cases", fuzz_options.max_cases);
+        get_arg(args, "--seed", fuzz_options.seed);
+        get_arg(args, "--max-ops", fuzz_options.max_ops);
+        if (!args.empty()) {
+            std::cerr << "Error, unknown fuzzing option " << args[0] << "\n"
+                      << "  --seconds <time budget>  --cases <cases instead of a time budget>\n"
+                      << "  --seed <first case seed>  --max-ops <operations per case>\n";
+            return 1;
+        }
+        return run_fuzz(fuzz_options);
+    }
 
     // Experiment mode
     std::vector<std::string> args(argv + 2, argv + argc);
@@ -76,7 +136,61 @@ int main(int argc, char* argv[]) {
                   << "  --trials <number>\n"
                   << "  --option <experiment-number>\n"
                   << "  --csv <filename>\n"
-                  << "  --graphs <true/false>\n";
+                  << "  --graphs <true/false>\n"
+                  << "Optional parameters:\n"
+                  << "  --ci-target <relative CI half width>  (--trials becomes the minimum)\n"
+                  << "  --max-trials <number>\n"
+                  << "  --seed <number>\n"
+                  << "  --warmup <completed jobs to delete>\n"
+                  << "  --mser <true/false>  (automatic warm-up length)\n"
+                  << "  --batches <number>  (batch means CI within each run)\n"
+                  << "  --migration-cost <work per moved server>  (assigns concrete servers, whole servers only)\n"
+                  << "  --p-prior <p>  (RCGREEDY estimates p from progress, starting at the prior)\n"
+                  << "  --p-noise <relative noise of measured progress>\n"
+                  << "  --p-prior-weight <measurements the prior counts as>\n"
+                  << "  --fanout <2, 4 or 8>  (children of every RCGREEDY group)\n"
+                  << "  --rebalance <arrivals between RCGREEDY bin rebalances>  (quantile adaptive bins)\n"
+                  << "  --bin-window <p values the bin quantiles are taken over>\n"
+                  << "  --auto-depth <arrivals between RCGREEDY depth retunes>\n"
+                  << "  --depth-evaluation-weight <objective gain one candidate split must buy>\n"
+                  << "  --capacity-amplitude <relative swing of the autoscaled server count>\n"
+                  << "  --capacity-period <time units per autoscaling cycle>\n"
+                  << "  --pools <number>  (splits the servers over federated scheduler instances)\n"
+                  << "  --pool-choices <pools sampled per arrival>\n"
+                  << "  --rebalance-epoch <time units between job moves across pools>\n"
+                  << "  --pipelined <true/false>  (generates, schedules and averages on separate threads)\n"
+                  << "  --fes <heap/calendar>  (future event set of the simulator)\n";
+        return 1;
+    }
+
+    // Optional parameters
+    TrialOptions trial_options;
+    get_arg(args, "--ci-target", trial_options.ci_target);
+    get_arg(args, "--max-trials", trial_options.max_trials);
+    get_arg(args, "--seed", trial_options.seed);
+
+    SimulationOptions sim_options;
+    get_arg(args, "--warmup", sim_options.warmup_jobs);
+    get_arg(args, "--mser", sim_options.warmup_mser);
+    get_arg(args, "--batches", sim_options.batch_count);
+    sim_options.assign_servers = get_arg(args, "--migration-cost", sim_options.migration_cost);
+    sim_options.estimate_p = get_arg(args, "--p-prior", sim_options.p_prior);
+    get_arg(args, "--p-noise", sim_options.progress_noise);
+    get_arg(args, "--p-prior-weight", sim_options.p_prior_weight);
+    get_arg(args, "--fanout", sim_options.fanout);
+    get_arg(args, "--rebalance", sim_options.bin_rebalance_interval);
+    get_arg(args, "--bin-window", sim_options.bin_window);
+    get_arg(args, "--auto-depth", sim_options.auto_depth_interval);
+    get_arg(args, "--depth-evaluation-weight", sim_options.depth_evaluation_weight);
+    get_arg(args, "--capacity-amplitude", sim_options.capacity_amplitude);
+    get_arg(args, "--capacity-period", sim_options.capacity_period);
+    get_arg(args, "--pools", sim_options.pools);
+    get_arg(args, "--pool-choices", sim_options.pool_choices);
+    get_arg(args, "--rebalance-epoch", sim_options.rebalance_epoch);
+    get_arg(args, "--pipelined", sim_options.pipelined);
+    std::string event_set;
+    if (get_arg(args, "--fes", event_set) && !parse_event_set_kind(event_set, sim_options.event_set)) {
+        std::cerr << "--fes must be heap or calendar\n";
         return 1;
     }
 
@@ -86,7 +200,7 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    experiments(trials, option, csv_output_file, generate_graphs);
+    experiments(trials, option, csv_output_file, generate_graphs, trial_options, sim_options);
     return 0;
 }
 
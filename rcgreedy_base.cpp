@@ -5,36 +5,488 @@ RCGREEDY::RCGREEDY(size_t servers, size_t max_depth, double average_size, bool p
     current_depth(std::min(max_depth, RCGREEDY::MAX_DEPTH)),
     partial_servers(partial_server_allocs),
     server_count(servers),  
-    maximization_constant(1/average_size) {
+    maximization_constant(1/average_size),
+    objective_kernel(select_objective_kernel()) {
     initalize_groups();
 
     // initally, give all of servers to the top group
-    groups[""].allocated_servers = server_count;
+    groups[0].allocated_servers = server_count;
+}
+
+// per event paths compiled for every supported tree, indexed by fanout_bits - 1 and levels
+const RCGREEDY::Depth_Ops RCGREEDY::depth_dispatch[3][RCGREEDY::MAX_DEPTH + 1] = {
+    {   // binary, levels = current_depth
+        {&RCGREEDY::add_job_impl<0, 1>, &RCGREEDY::delete_job_impl<0, 1>},
+        {&RCGREEDY::add_job_impl<1, 1>, &RCGREEDY::delete_job_impl<1, 1>},
+        {&RCGREEDY::add_job_impl<2, 1>, &RCGREEDY::delete_job_impl<2, 1>},
+        {&RCGREEDY::add_job_impl<3, 1>, &RCGREEDY::delete_job_impl<3, 1>},
+        {&RCGREEDY::add_job_impl<4, 1>, &RCGREEDY::delete_job_impl<4, 1>},
+        {&RCGREEDY::add_job_impl<5, 1>, &RCGREEDY::delete_job_impl<5, 1>},
+        {&RCGREEDY::add_job_impl<6, 1>, &RCGREEDY::delete_job_impl<6, 1>},
+        {&RCGREEDY::add_job_impl<7, 1>, &RCGREEDY::delete_job_impl<7, 1>},
+        {&RCGREEDY::add_job_impl<8, 1>, &RCGREEDY::delete_job_impl<8, 1>},
+        {&RCGREEDY::add_job_impl<9, 1>, &RCGREEDY::delete_job_impl<9, 1>},
+        {&RCGREEDY::add_job_impl<10, 1>, &RCGREEDY::delete_job_impl<10, 1>},
+    },
+    {   // fanout 4, at most 5 levels for a depth of 10
+        {&RCGREEDY::add_job_impl<0, 2>, &RCGREEDY::delete_job_impl<0, 2>},
+        {&RCGREEDY::add_job_impl<1, 2>, &RCGREEDY::delete_job_impl<1, 2>},
+        {&RCGREEDY::add_job_impl<2, 2>, &RCGREEDY::delete_job_impl<2, 2>},
+        {&RCGREEDY::add_job_impl<3, 2>, &RCGREEDY::delete_job_impl<3, 2>},
+        {&RCGREEDY::add_job_impl<4, 2>, &RCGREEDY::delete_job_impl<4, 2>},
+        {&RCGREEDY::add_job_impl<5, 2>, &RCGREEDY::delete_job_impl<5, 2>},
+    },
+    {   // fanout 8, at most 4 levels
+        {&RCGREEDY::add_job_impl<0, 3>, &RCGREEDY::delete_job_impl<0, 3>},
+        {&RCGREEDY::add_job_impl<1, 3>, &RCGREEDY::delete_job_impl<1, 3>},
+        {&RCGREEDY::add_job_impl<2, 3>, &RCGREEDY::delete_job_impl<2, 3>},
+        {&RCGREEDY::add_job_impl<3, 3>, &RCGREEDY::delete_job_impl<3, 3>},
+        {&RCGREEDY::add_job_impl<4, 3>, &RCGREEDY::delete_job_impl<4, 3>},
+    },
+};
+
+void RCGREEDY::set_objective_kernel(Objective_Kernel kernel) {
+    objective_kernel = kernel;
+}
+
+void RCGREEDY::set_admission(Admission order) {
+    if (partial_servers && order != Admission::ALL) {
+        std::cerr << "Error, admission queues only apply to whole server allocation" << std::endl;
+        return;
+    }
+    if (jobs.size()) {
+        std::cerr << "Error, admission order must be set before jobs are added" << std::endl;
+        return;
+    }
+    admission = order;
+}
+
+size_t RCGREEDY::get_waiting_count() const {
+    return waiting_count;
+}
+
+void RCGREEDY::set_fanout(size_t new_fanout) {
+    if (new_fanout != 2 && new_fanout != 4 && new_fanout != 8) {
+        std::cerr << "Error, fanout must be 2, 4 or 8" << std::endl;
+        return;
+    }
+    if (jobs.size()) {
+        std::cerr << "Error, fanout must be set before jobs are added" << std::endl;
+        return;
+    }
+    fanout = new_fanout;
+    fanout_bits = __builtin_ctzll(new_fanout);
+    initalize_groups();
+}
+
+size_t RCGREEDY::get_fanout() const {
+    return fanout;
+}
+
+void RCGREEDY::set_adaptive_bins(size_t interval, size_t window) {
+    if (jobs.size()) {
+        std::cerr << "Error, adaptive bins must be set before jobs are added" << std::endl;
+        return;
+    }
+    if (interval && !window) {
+        std::cerr << "Error, adaptive bins need a window of at least one p value" << std::endl;
+        return;
+    }
+    rebalance_interval = interval;
+    adds_since_rebalance = 0;
+    p_window.assign(interval ? window : 0, 0.0);
+    p_window_size = 0;
+    p_window_next = 0;
+    leaf_bounds.clear();
+}
+
+void RCGREEDY::rebalance_bins() {
+    history.clear();
+    rebalance_bins_impl();
+}
+
+void RCGREEDY::rebalance_bins_impl() {
+    if (!p_window_size) return;
+    adds_since_rebalance = 0;
+
+    // leaf i starts at the i / leaf_count quantile of the window
+    const size_t leaf_count = leaf_jobs.size();
+    sorted_window.assign(p_window.begin(), p_window.begin() + p_window_size);
+    std::sort(sorted_window.begin(), sorted_window.end());
+    leaf_bounds.resize(leaf_count - 1);
+    for (size_t i = 1; i < leaf_count; ++i) {
+        leaf_bounds[i - 1] = sorted_window[i * p_window_size / leaf_count];
+    }
+
+    migrate_jobs();
+}
+
+void RCGREEDY::set_auto_depth(size_t interval, double weight) {
+    if (jobs.size()) {
+        std::cerr << "Error, auto depth must be set before jobs are added" << std::endl;
+        return;
+    }
+    tune_interval = interval;
+    evaluation_weight = weight;
+    adds_since_tune = 0;
+}
+
+bool RCGREEDY::tune_depth() {
+    history.clear();
+    return tune_depth_impl();
+}
+
+bool RCGREEDY::tune_depth_impl() {
+    adds_since_tune = 0;
+    if (!groups[0].job_count) return false;
+
+    // score every depth against the gain it predicts over a single shared group
+    double base_objective = 0.0;
+    size_t best_depth = 0;
+    double best_score = 0.0;
+    for (size_t depth = 0; depth <= levels; ++depth) {
+        double objective;
+        size_t evaluations;
+        predict_depth(depth, objective, evaluations);
+        if (depth == 0) base_objective = objective;
+
+        double gain = base_objective > 0.0 ? objective / base_objective - 1.0 : 0.0;
+        double score = gain - evaluation_weight * static_cast<double>(evaluations);
+        if (depth == 0 || score - best_score > EPSILON) {
+            best_depth = depth;
+            best_score = score;
+        }
+    }
+
+    if (best_depth == effective_levels) return false;
+    effective_levels = best_depth;
+    leaf_shift = fanout_bits * (levels - effective_levels);
+    migrate_jobs();
+    return true;
+}
+
+size_t RCGREEDY::get_effective_depth() const {
+    return effective_levels;
+}
+
+size_t RCGREEDY::get_split_evaluations() const {
+    return split_evaluations;
+}
+
+void RCGREEDY::predict_depth(size_t depth, double &objective, size_t &evaluations) {
+    // group statistics of a tree with depth levels, from the admitted jobs' own p values
+    const size_t bin_count = size_t(1) << (fanout_bits * depth);
+    const size_t first_bin = (bin_count - 1) / (fanout - 1);
+    const size_t bin_shift = fanout_bits * (levels - depth);
+    prediction_tree.assign(first_bin + bin_count, Group{});
+    for (size_t word = 0; word < occupied_leaves.size(); ++word) {
+        for (uint64_t bits = occupied_leaves[word]; bits; bits &= bits - 1) {
+            size_t leaf = word * 64 + __builtin_ctzll(bits);
+            for (uint32_t slot = leaf_jobs[leaf].head; slot != Job_Pool::NONE; slot = jobs[slot].next) {
+                Group &bin = prediction_tree[first_bin + (full_depth_leaf(jobs[slot].p) >> bin_shift)];
+                bin.job_count += 1;
+                bin.total_p += jobs[slot].p;
+            }
+        }
+    }
+    for (size_t group = first_bin; group > 0; --group) {
+        for (size_t child = fanout * (group - 1) + 1; child <= fanout * group; ++child) {
+            prediction_tree[group - 1].job_count += prediction_tree[child].job_count;
+            prediction_tree[group - 1].total_p += prediction_tree[child].total_p;
+        }
+    }
+
+    // split the servers top-down as a full reallocation would, parents come before children
+    const size_t start_evaluations = split_evaluations;
+    prediction_tree[0].allocated_servers = server_count;
+    for (size_t group = 0; group < first_bin; ++group) {
+        if (!prediction_tree[group].job_count) continue;
+        size_t child_servers[MAX_FANOUT];
+        split_group(prediction_tree, group, prediction_tree[group].allocated_servers, child_servers);
+        for (size_t i = 0; i < fanout; ++i) prediction_tree[fanout * group + 1 + i].allocated_servers = child_servers[i];
+    }
+    evaluations = split_evaluations - start_evaluations;
+    split_evaluations = start_evaluations;  // a prediction isn't work done on the real tree
+
+    objective = 0.0;
+    for (size_t bin = first_bin; bin < first_bin + bin_count; ++bin) {
+        const Group &group = prediction_tree[bin];
+        if (!group.job_count || !group.allocated_servers) continue;
+        double job_count = static_cast<double>(group.job_count);
+        objective += job_count * speedup_factor(group.total_p / job_count, group.allocated_servers / job_count);
+    }
+    objective *= maximization_constant;
+}
+
+void RCGREEDY::observe_p(double p) {
+    p_window[p_window_next] = p;
+    p_window_next = (p_window_next + 1) % p_window.size();
+    p_window_size = std::min(p_window_size + 1, p_window.size());
+}
+
+void RCGREEDY::migrate_jobs() {
+    // collect every job, admitted ones first so they stay admitted
+    moved_slots.clear();
+    for (const Job_Pool::List &list : leaf_jobs) {
+        for (uint32_t slot = list.head; slot != Job_Pool::NONE; slot = jobs[slot].next) moved_slots.push_back(slot);
+    }
+    const size_t admitted_count = moved_slots.size();
+    for (const Job_Pool::List &list : leaf_waiting) {
+        for (uint32_t slot = list.head; slot != Job_Pool::NONE; slot = jobs[slot].next) moved_slots.push_back(slot);
+    }
+
+    std::fill(leaf_jobs.begin(), leaf_jobs.end(), Job_Pool::List{});
+    std::fill(leaf_waiting.begin(), leaf_waiting.end(), Job_Pool::List{});
+    for (Group &group : groups) {
+        group.job_count = 0;
+        group.total_p = 0.0;
+    }
+
+    // relink the jobs in their old order, a waiting job is only admitted if its new leaf would
+    // otherwise have none (the reallocation admits the rest as servers allow). An admitted job
+    // stays admitted here, the reallocation lists every admitted job and any it sends back to
+    // a queue at 0 servers
+    for (size_t i = 0; i < moved_slots.size(); ++i) {
+        uint32_t slot = moved_slots[i];
+        size_t leaf = get_leaf(jobs[slot].p);
+        jobs[slot].leaf = static_cast<uint32_t>(leaf);
+        if (i >= admitted_count && leaf_jobs[leaf].size) {
+            jobs.link_back(leaf_waiting[leaf], slot);
+            continue;
+        }
+        if (jobs[slot].waiting) {
+            jobs[slot].waiting = false;
+            waiting_count -= 1;
+        }
+        jobs.link_back(leaf_jobs[leaf], slot);
+        groups[first_leaf + leaf].job_count += 1;
+        groups[first_leaf + leaf].total_p += jobs[slot].p;
+    }
+
+    // sum the statistics up the tree, children always come after their parent
+    for (size_t group = first_leaf; group > 0; --group) {
+        for (size_t child = fanout * (group - 1) + 1; child <= fanout * group; ++child) {
+            groups[group - 1].job_count += groups[child].job_count;
+            groups[group - 1].total_p += groups[child].total_p;
+        }
+    }
+    for (size_t leaf = 0; leaf < leaf_jobs.size(); ++leaf) update_occupied(leaf);
+
+    // added to the history of whatever triggered the migration, which may have sent jobs back
+    // to their queues that are still waiting
+    realloc_all();
+}
+
+void RCGREEDY::reserve(size_t job_capacity) {
+    jobs.reserve(job_capacity);
+    history.reserve(job_capacity);
 }
 
 void RCGREEDY::full_realloc() {
+    history.clear();
+    realloc_all();
+}
+
+void RCGREEDY::realloc_all() {
     max_update += 1;
+    allocation_drift = 0.0;
+    events_since_realloc = 0;
+
+    // a full reallocation supersedes any incremental one in progress
+    realloc_stack.clear();
+    staged_allocs.clear();
+
+    if (!groups[0].job_count) return;
+    partial_realloc(0);
+}
+
+void RCGREEDY::set_adaptive_realloc(double threshold, size_t max_events) {
+    drift_threshold = threshold;
+    drift_max_events = max_events;
+}
+
+bool RCGREEDY::adaptive_realloc() {
+    if (drift_threshold <= 0.0) return false;
+
+    if (allocation_drift >= drift_threshold 
+        || (drift_max_events && events_since_realloc >= drift_max_events)) {
+        full_realloc();
+        return true;
+    }
+    return false;
+}
+
+double RCGREEDY::get_allocation_drift() const {
+    return allocation_drift;
+}
+
+bool RCGREEDY::realloc_step(size_t budget) {
+    // start a new pass from the root if needed
+    if (!realloc_in_progress()) {
+        pass_update = max_update;
+        realloc_stack.push_back({0, groups[0].allocated_servers});
+    }
+
+    // split groups top-down, same as partial_realloc but into the staging area
+    while (budget && !realloc_stack.empty()) {
+        Staged_Alloc current = realloc_stack.back();
+        realloc_stack.pop_back();
+        budget -= 1;
+
+        staged_allocs.push_back(current);
+        if (current.group >= first_leaf) continue;
+
+        size_t child_servers[MAX_FANOUT];
+        split_group(groups, current.group, current.servers, child_servers);
+        const size_t first_child = fanout * current.group + 1;
+
+        // children without jobs are final, the others are split later, lowest p first
+        for (size_t i = 0; i < fanout; ++i) {
+            if (!groups[first_child + i].job_count) staged_allocs.push_back({first_child + i, 0, true});
+        }
+        for (size_t i = fanout; i > 0; --i) {
+            if (groups[first_child + i - 1].job_count) {
+                realloc_stack.push_back({first_child + i - 1, child_servers[i - 1]});
+            }
+        }
+    }
+
+    if (!realloc_stack.empty()) return false;
+
+    // every group is staged, commit the new allocation at once
+    max_update += 1;
+    const size_t commit_update = max_update;
     history.clear();
-    if (!groups[""].job_count) return;
-    partial_realloc("");
+    allocation_drift = 0.0;
+    events_since_realloc = 0;
+
+    // a local reallocation between steps split some groups again with fresher statistics than
+    // the staged ones. The topmost of them only take their staged servers and are split again
+    // below, nothing staged inside their subtrees is committed. The stack is empty once every
+    // group is staged, so it holds them
+    auto split_during_pass = [&](size_t group) {
+        return groups[group].update_count > pass_update && groups[group].update_count < commit_update;
+    };
+    for (const Staged_Alloc &alloc : staged_allocs) {
+        if (split_during_pass(alloc.group) && (!alloc.group || !split_during_pass((alloc.group - 1) / fanout))) {
+            realloc_stack.push_back(alloc);
+        }
+    }
+    // with below_root, a topmost resplit group itself doesn't count as inside
+    auto inside_resplit = [&](size_t group, bool below_root) {
+        for (const Staged_Alloc &resplit : realloc_stack) {
+            if (below_root && group == resplit.group) continue;
+            size_t ancestor = group;
+            while (ancestor > resplit.group) ancestor = (ancestor - 1) / fanout;
+            if (ancestor == resplit.group) return true;
+        }
+        return false;
+    };
+
+    for (const Staged_Alloc &alloc : staged_allocs) {
+        if (inside_resplit(alloc.group, false)) continue;
+        Group &group = groups[alloc.group];
+        bool changed = group.allocated_servers != alloc.servers;
+        group.allocated_servers = alloc.servers;
+        group.update_count = commit_update;
+
+        // only leaves with jobs whose allocation or population moved produce history
+        if (alloc.group >= first_leaf && group.job_count) {
+            bool admitted = admit_waiting(alloc.group - first_leaf);
+            if (changed || admitted) get_group_server_count(alloc.group, history);
+        }
+    }
+    for (const Staged_Alloc &resplit : realloc_stack) {
+        groups[resplit.group].allocated_servers = resplit.servers;
+        max_update += 1;
+        if (groups[resplit.group].job_count) {
+            partial_realloc(resplit.group);
+        } else {
+            groups[resplit.group].update_count = max_update;
+        }
+    }
+
+    // a subtree skipped for having no jobs may have gained some during the pass, and one
+    // staged with jobs may have lost them all. Either way its committed servers are wrong, so
+    // split the parent again with the committed servers and current statistics, under a fresh
+    // update count so that servers just committed below an emptied group go stale. This holds
+    // for the topmost resplit groups too, their parents were committed from the staging area
+    for (const Staged_Alloc &alloc : staged_allocs) {
+        if (!alloc.group || inside_resplit(alloc.group, true)) continue;
+        const size_t parent = (alloc.group - 1) / fanout;
+        bool emptied = !alloc.pruned && !groups[alloc.group].job_count;
+        bool filled = alloc.pruned && groups[alloc.group].job_count;
+
+        // a parent already split again in this commit has nothing stale below it
+        if ((emptied || filled) && groups[parent].job_count && groups[parent].update_count <= commit_update) {
+            max_update += 1;
+            partial_realloc(parent);
+        }
+    }
+    realloc_stack.clear();
+    staged_allocs.clear();
+    return true;
 }
 
-void RCGREEDY::add_job(RCGREEDY_Job &job, bool forced_local_realloc) {
-    if (job_group_assignments.find(job) != job_group_assignments.end()) {
+bool RCGREEDY::realloc_in_progress() const {
+    return !realloc_stack.empty() || !staged_allocs.empty();
+}
+
+void RCGREEDY::set_server_count(size_t servers) {
+    history.clear();
+
+    // staged allocations were split from the old count
+    realloc_stack.clear();
+    staged_allocs.clear();
+
+    server_count = servers;
+    if (groups[0].allocated_servers == servers) return;
+    groups[0].allocated_servers = servers;
+    if (groups[0].job_count) {
+        redistribute(0);
+    } else {
+        // nothing to split, a fresh update count makes the servers left in the tree stale
+        groups[0].update_count = ++max_update;
+    }
+}
+
+size_t RCGREEDY::get_server_count() const {
+    return server_count;
+}
+
+template <size_t Levels, size_t Bits>
+void RCGREEDY::add_job_impl(RCGREEDY_Job &job, bool forced_local_realloc) {
+    if (jobs.find(job.id) != Job_Pool::NONE) {
         std::cerr << "Error adding job " << job.id << ". Job already exists" << std::endl;
         return; 
     }
 
-    std::string group = get_group_id(job);
-    id_to_jobs[group].insert(job); // add job to group list
-    std::string last_level_w_servers = ""; // used for local realloc
-    std::string c_level;
-    size_t current_update = groups[""].update_count;
-    history.clear(); // new action, remake history vector
+    size_t leaf = leaf_bounds.empty() ? (depth_leaf<Levels, Bits>(job.p) >> leaf_shift) << leaf_shift : get_leaf(job.p);
+    uint32_t slot = jobs.insert(job.id, job.p);
+    jobs[slot].leaf = static_cast<uint32_t>(leaf);
+    if (!moving_job) history.clear(); // new action, remake history vector
+
+    // wait in the admission queue if the leaf has no servers to spare
+    const Group &leaf_group = groups[depth_first_leaf<Levels, Bits>() + leaf];
+    if (admission != Admission::ALL && leaf_group.job_count
+        && leaf_group.job_count >= std::max<size_t>(1, refresh_leaf(leaf))) {
+        jobs[slot].waiting = true;
+        jobs.link_back(leaf_waiting[leaf], slot);
+        waiting_count += 1;
+        if (moving_job) history.push_back({job.id, 0.0});   // it may have held servers in its old leaf
+        return;
+    }
+
+    jobs.link(leaf_jobs[leaf], slot); // add job to group list
+    update_occupied(leaf);
+    size_t last_level_w_servers = 0; // used for local realloc
+    size_t c_level = 0;
+    size_t current_update = groups[0].update_count;
+    double drift = 0.0;
 
     // find highest level where it is the only job
-    for (size_t len = 0; len <= group.size(); ++len) {
-        c_level = group.substr(0, len);
+    for (size_t depth = 0; depth <= Levels; ++depth) {
+        c_level = depth_ancestor<Levels, Bits>(leaf, depth);
 
         // check if group information is updated
         if (groups[c_level].update_count >= current_update) {
@@ -56,9 +508,13 @@ void RCGREEDY::add_job(RCGREEDY_Job &job, bool forced_local_realloc) {
         // update job counts
         groups[c_level].job_count += 1;
         groups[c_level].total_p += job.p;
+        drift += 1.0 / groups[c_level].job_count;
 
     }
 
+    allocation_drift += drift / (Levels + 1);
+    events_since_realloc += 1;
+
     // local realloc if no servers available
     if (forced_local_realloc && c_level != last_level_w_servers) {
         max_update += 1;
@@ -69,78 +525,216 @@ void RCGREEDY::add_job(RCGREEDY_Job &job, bool forced_local_realloc) {
     }
 }
 
-void RCGREEDY::delete_job(RCGREEDY_Job &job, bool forced_local_realloc){
-    if (job_group_assignments.find(job) == job_group_assignments.end()) {
+void RCGREEDY::add_job(RCGREEDY_Job &job, bool forced_local_realloc) {
+    if (!rebalance_interval && !tune_interval) {
+        (this->*depth_ops.add_job)(job, forced_local_realloc);
+        return;
+    }
+
+    bool added = jobs.find(job.id) == Job_Pool::NONE;
+    (this->*depth_ops.add_job)(job, forced_local_realloc);
+    if (!added) return;
+    if (rebalance_interval) {
+        observe_p(job.p);
+        if (++adds_since_rebalance >= rebalance_interval) rebalance_bins_impl();
+    }
+    if (tune_interval && ++adds_since_tune >= tune_interval) tune_depth_impl();
+}
+
+template <size_t Levels, size_t Bits>
+void RCGREEDY::delete_job_impl(RCGREEDY_Job &job, bool forced_local_realloc) {
+    uint32_t slot = jobs.find(job.id);
+    if (slot == Job_Pool::NONE) {
         std::cerr << "Error deleting job " << job.id << ". Job doesn't exist." << std::endl;
         return; 
     }
 
-    std::string group = job_group_assignments[job];
+    const size_t leaf = jobs[slot].leaf;
+    const size_t group = depth_first_leaf<Levels, Bits>() + leaf;
+    const double p = jobs[slot].p;
 
-    history.clear(); // new action, remake history vector
-    std::string c_level;
-    std::string lowest_job_level;     // where to realloc servers to if needed
+    if (!moving_job) history.clear(); // new action, remake history vector
+
+    // waiting jobs aren't part of any group
+    if (jobs[slot].waiting) {
+        jobs.unlink(leaf_waiting[leaf], slot);
+        jobs.erase(slot);
+        waiting_count -= 1;
+        return;
+    }
+
+    size_t c_level;
+    size_t lowest_job_level = 0;      // where to realloc servers to if needed, 0 until found
     size_t realloc_server_count = 0;
+    double drift = 0.0;
 
 
-    // only perform local realloc if there are no more jobs at the level
-    forced_local_realloc &= (groups[group].job_count == 1);
+    // only perform local realloc if there are no more jobs at the level, 
+    // including waiting jobs that will be admitted into it
+    forced_local_realloc &= (groups[group].job_count == 1 && !leaf_waiting[leaf].size);
     if (forced_local_realloc) {
         realloc_server_count = groups[group].allocated_servers; // these are removed from group below
     }
 
     // move up the allocation 
-    for (size_t len = group.size() + 1; len > 0; --len) {
-        c_level = group.substr(0, len - 1);
+    for (size_t depth = Levels + 1; depth > 0; --depth) {
+        c_level = depth_ancestor<Levels, Bits>(leaf, depth - 1);
 
         // edit group information
+        drift += 1.0 / groups[c_level].job_count;
         groups[c_level].job_count -= 1;
-        groups[c_level].total_p -= job.p;
+        groups[c_level].total_p -= p;
 
-        if (forced_local_realloc && lowest_job_level.empty()) {
-            // see if this is level for realloc
+        if (forced_local_realloc && !lowest_job_level) {
+            // see if this is level for realloc, the sibling of the path's child
             if (groups[c_level].job_count) {
-                lowest_job_level = (group[c_level.size()] == '1') ? c_level + "0" : c_level + "1";
-            } else if (c_level != "") {
+                size_t child = depth_ancestor<Levels, Bits>(leaf, depth);
+                if constexpr (Bits == 1) {
+                    lowest_job_level = (child % 2) ? child + 1 : child - 1;
+                } else {
+                    // wider groups split the servers among all of their children again,
+                    // remember the emptied child (never the root) to find the group
+                    lowest_job_level = child;
+                }
+            } else if (c_level != 0) {
                 // remove servers from level for realloc
                 groups[c_level].allocated_servers -= realloc_server_count;
             }
             
         }
-        if (len == 0) break;
     }
 
-    // if erase failed, element doesn't exist here
-    if (!id_to_jobs[group].erase(job)) {
-        std::cerr << "Error deleting job " << job.id << ". Job not found in group." << std::endl;
-        return;
-    }
+    allocation_drift += drift / (Levels + 1);
+    events_since_realloc += 1;
 
+    // remove the job from its group and recycle its record
+    jobs.unlink(leaf_jobs[leaf], slot);
+    jobs.erase(slot);
 
-    if (forced_local_realloc && !lowest_job_level.empty()) {
-        groups[lowest_job_level].allocated_servers += realloc_server_count;
+    if (forced_local_realloc && lowest_job_level) {
         max_update += 1;
-        partial_realloc(lowest_job_level);
-        job_group_assignments.erase(job); // erase the mapping
+        if constexpr (Bits == 1) {
+            groups[lowest_job_level].allocated_servers += realloc_server_count;
+            partial_realloc(lowest_job_level);
+        } else {
+            partial_realloc((lowest_job_level - 1) >> Bits);
+        }
     } else {
-        // add history of local realloc isn't performed
+        // add history of the remaining jobs if local realloc isn't performed
+        admit_waiting(leaf);
         if (groups[group].job_count) {
-            get_job_group_server_count(job, history);
+            get_group_server_count(group, history);
         }
-        job_group_assignments.erase(job); // erase the mapping
+    }
+    update_occupied(leaf);
+}
+
+void RCGREEDY::delete_job(RCGREEDY_Job &job, bool forced_local_realloc) {
+    (this->*depth_ops.delete_job)(job, forced_local_realloc);
+}
+
+void RCGREEDY::update_job_p(RCGREEDY_Job &job, double new_p, bool forced_local_realloc) {
+    uint32_t slot = jobs.find(job.id);
+    if (slot == Job_Pool::NONE) {
+        std::cerr << "Error updating job " << job.id << ". Job doesn't exist." << std::endl;
+        return; 
+    }
+
+    if (rebalance_interval) observe_p(new_p);
+    const size_t old_leaf = jobs[slot].leaf;
+    const size_t new_leaf = get_leaf(new_p);
+    const double old_p = jobs[slot].p;
+    const Group &new_leaf_group = groups[first_leaf + new_leaf];
+    job.p = new_p;
+
+    // waiting jobs aren't in any group, and a job that would have to wait in its new leaf
+    // leaves its groups entirely, so both are simply moved
+    if (jobs[slot].waiting || (admission != Admission::ALL && old_leaf != new_leaf && new_leaf_group.job_count
+        && new_leaf_group.job_count >= std::max<size_t>(1, refresh_leaf(new_leaf)))) {
+        // the history of both halves is kept, the delete can admit jobs the add makes wait
+        history.clear();
+        moving_job = true;
+        delete_job(job, forced_local_realloc);
+        (this->*depth_ops.add_job)(job, forced_local_realloc);   // not a new job for the adaptive bins
+        moving_job = false;
+        return;
+    }
+
+    history.clear(); // new action, remake history vector
+    jobs[slot].p = new_p;
+
+    // the groups above where the paths split keep their jobs, only total_p changes
+    size_t split_depth = 0;     // lowest depth where both leaves share a group
+    size_t current_update = groups[0].update_count;
+    for (size_t depth = 0; depth <= levels; ++depth) {
+        size_t c_level = leaf_ancestor(old_leaf, depth);
+        if (c_level != leaf_ancestor(new_leaf, depth)) break;
+        split_depth = depth;
+        current_update = std::max(current_update, groups[c_level].update_count);
+        groups[c_level].total_p += new_p - old_p;
+    }
+
+    if (old_leaf == new_leaf) return;
+
+    // move the job along the diverging parts of the paths
+    double drift = 0.0;
+    bool new_leaf_has_servers = false;
+    for (size_t depth = split_depth + 1; depth <= levels; ++depth) {
+        Group &old_group = groups[leaf_ancestor(old_leaf, depth)];
+        drift += 1.0 / old_group.job_count;
+        old_group.job_count -= 1;
+        old_group.total_p -= old_p;
+
+        Group &new_group = groups[leaf_ancestor(new_leaf, depth)];
+        if (new_group.update_count >= current_update) {
+            current_update = new_group.update_count;
+        } else {
+            // udpate group information
+            new_group.update_count = current_update;
+            new_group.allocated_servers = 0;
+        }
+        if (depth == levels) {
+            new_leaf_has_servers = new_group.allocated_servers > new_group.job_count
+                                   || (new_group.allocated_servers && partial_servers);
+        }
+        new_group.job_count += 1;
+        new_group.total_p += new_p;
+        drift += 1.0 / new_group.job_count;
+    }
+
+    allocation_drift += drift / (levels + 1);
+    events_since_realloc += 1;
+
+    jobs.unlink(leaf_jobs[old_leaf], slot);
+    jobs[slot].leaf = static_cast<uint32_t>(new_leaf);
+    jobs.link(leaf_jobs[new_leaf], slot);
+    admit_waiting(old_leaf);
+    update_occupied(old_leaf);
+    update_occupied(new_leaf);
+
+    const size_t old_group = first_leaf + old_leaf;
+    const size_t new_group = first_leaf + new_leaf;
+    if (forced_local_realloc && (!groups[old_group].job_count || !new_leaf_has_servers)) {
+        max_update += 1;
+        partial_realloc(leaf_ancestor(old_leaf, split_depth));
+    } else {
+        if (groups[old_group].job_count) get_group_server_count(old_group, history);
+        get_group_server_count(new_group, history);
     }
 }
 
 double RCGREEDY::get_server_count(RCGREEDY_Job &job) {
-    if (job_group_assignments.find(job) == job_group_assignments.end()) {
+    uint32_t slot = jobs.find(job.id);
+    if (slot == Job_Pool::NONE) {
         std::cerr << "Error finding job " << job.id << ". Job doesn't exist." << std::endl;
         return -1.0;
     } 
 
-    std::string group = job_group_assignments[job];
+    const size_t group = first_leaf + jobs[slot].leaf;
+    if (jobs[slot].waiting) return 0.0;
 
     if (groups[group].job_count == 0) {
-        std::cerr << "Error, group " << group << "has no jobs" << std::endl;
+        std::cerr << "Error, group " << group << " has no jobs" << std::endl;
         return -1.0;
     }
 
@@ -155,8 +749,8 @@ double RCGREEDY::get_server_count(RCGREEDY_Job &job) {
     if (remainder == 0) return base;
 
     // if it is one of the first jobs, it gets the remainder servers, otherwise it does not
-    for (const RCGREEDY_Job& grouped_job : id_to_jobs[group]) {
-        if (grouped_job == job) return base + 1;
+    for (uint32_t c_slot = leaf_jobs[jobs[slot].leaf].head; c_slot != Job_Pool::NONE; c_slot = jobs[c_slot].next) {
+        if (c_slot == slot) return base + 1;
         remainder -= 1;
         if (remainder == 0) return base;
     }
@@ -164,12 +758,18 @@ double RCGREEDY::get_server_count(RCGREEDY_Job &job) {
 }
 
 void RCGREEDY::get_job_group_server_count(RCGREEDY_Job &job, std::vector<std::pair<size_t, double>> &input) {
-    if (job_group_assignments.find(job) == job_group_assignments.end()) {
+    uint32_t slot = jobs.find(job.id);
+    if (slot == Job_Pool::NONE) {
         std::cerr << "Error finding job " << job.id << ". Job doesn't exist." << std::endl;
         return; 
     }
 
-    const std::string group = job_group_assignments[job];
+    const size_t group = first_leaf + jobs[slot].leaf;
+
+    if (jobs[slot].waiting) {
+        input.push_back({job.id, 0.0});
+        return;
+    }
 
     if (groups[group].job_count == 1) {
         input.push_back({job.id, static_cast<double>(groups[group].allocated_servers)});
@@ -180,10 +780,14 @@ void RCGREEDY::get_job_group_server_count(RCGREEDY_Job &job, std::vector<std::pa
 
 void RCGREEDY::get_all_server_count(std::vector<std::pair<size_t, double>> &input) {
     
-    // iterate through only the lowest level ids
-    for (const auto& pair : id_to_jobs) {
-        if (!pair.second.empty()) { // only process groups with jobs
-            get_group_server_count(pair.first, input);
+    // iterate through only the lowest level groups with jobs
+    for (size_t word = 0; word < occupied_leaves.size(); ++word) {
+        for (uint64_t bits = occupied_leaves[word]; bits; bits &= bits - 1) {
+            size_t leaf = word * 64 + __builtin_ctzll(bits);
+            get_group_server_count(first_leaf + leaf, input);
+            for (uint32_t slot = leaf_waiting[leaf].head; slot != Job_Pool::NONE; slot = jobs[slot].next) {
+                input.push_back({jobs[slot].id, 0.0});
+            }
         }
     }
 
@@ -191,10 +795,10 @@ void RCGREEDY::get_all_server_count(std::vector<std::pair<size_t, double>> &inpu
 }
 
 
-void RCGREEDY::get_group_server_count(const std::string &group, std::vector<std::pair<size_t, double>> &input) {
+void RCGREEDY::get_group_server_count(size_t group, std::vector<std::pair<size_t, double>> &input) {
 
     if (groups[group].job_count == 0) {
-        std::cerr << "Error, group " << group << "has no jobs" << std::endl;
+        std::cerr << "Error, group " << group << " has no jobs" << std::endl;
         return;
     }
 
@@ -213,123 +817,483 @@ void RCGREEDY::get_group_server_count(const std::string &group, std::vector<std:
     
 
     // if it is one of the first jobs, it gets the remainder servers, otherwise it does not
-    for (const RCGREEDY_Job& grouped_job : id_to_jobs[group]) {
+    for (uint32_t slot = leaf_jobs[group - first_leaf].head; slot != Job_Pool::NONE; slot = jobs[slot].next) {
         if (remainder > 0) {
             remainder -= 1;
         } else if (!flip) {
             server_alloc -= 1;
             flip = true;
         }
-        input.push_back({grouped_job.id, server_alloc});
+        input.push_back({jobs[slot].id, server_alloc});
     }
 
     return;
 }
 
-std::vector<std::pair<size_t, double>> RCGREEDY::get_server_changes() {
+size_t RCGREEDY::get_job_leaf(RCGREEDY_Job &job) {
+    uint32_t slot = jobs.find(job.id);
+    if (slot == Job_Pool::NONE) {
+        std::cerr << "Error finding job " << job.id << ". Job doesn't exist." << std::endl;
+        return static_cast<size_t>(-1);
+    }
+    return jobs[slot].leaf;
+}
+
+const std::vector<std::pair<size_t, double>>& RCGREEDY::get_server_changes() const {
     return history;
 }
 
-void RCGREEDY::initalize_groups(){
-    groups[""] = Group{0, server_count, 0, 0.0};
-    generate_mappings(0.0, 1.0, "", current_depth);
+size_t RCGREEDY::memory_footprint() const {
+    return sizeof(*this)
+        + groups.capacity() * sizeof(Group)
+        + (leaf_jobs.capacity() + leaf_waiting.capacity()) * sizeof(Job_Pool::List)
+        + occupied_leaves.capacity() * sizeof(uint64_t)
+        + (p_window.capacity() + leaf_bounds.capacity() + sorted_window.capacity()) * sizeof(double)
+        + moved_slots.capacity() * sizeof(uint32_t)
+        + prediction_tree.capacity() * sizeof(Group)
+        + jobs.memory_footprint()
+        + history.capacity() * sizeof(std::pair<size_t, double>)
+        + (realloc_stack.capacity() + staged_allocs.capacity()) * sizeof(Staged_Alloc);
 }
 
-void RCGREEDY::generate_mappings(double c_p_min, double c_p_max, std::string c_string, int remaining_depth){
-    double diff = (c_p_max - c_p_min) / 2;
+uint64_t RCGREEDY::image_layout() {
+    const uint64_t version = 2;
+    return version << 48 | uint64_t(sizeof(Staged_Alloc)) << 32 | uint64_t(sizeof(Job_Pool::Record)) << 24
+         | uint64_t(sizeof(Job_Pool::List)) << 16 | uint64_t(sizeof(Group)) << 8 | sizeof(size_t);
+}
 
-    // add new mappings
-    groups[c_string + "1"] = Group{0, 0, 0, 0.0};
-    groups[c_string + "0"] = Group{0, 0, 0, 0.0};
+void RCGREEDY::snapshot(std::vector<char> &image) const {
+    Image_Writer writer(image);
+    writer.header(RCGREEDY_IMAGE, image_layout());
+    writer.put(current_depth);
+    writer.put(partial_servers);
+    writer.put(server_count);
+    writer.put(maximization_constant);
+    writer.put(fanout);
+    writer.put(admission);
 
-    // add new mappings for longer strings
-    if (remaining_depth > 1) {
-        generate_mappings(c_p_min + diff, c_p_max, c_string + "1", remaining_depth - 1);
-        generate_mappings(c_p_min, c_p_max - diff, c_string + "0", remaining_depth - 1);
-    } else {
-        // initalize empty unordered sets to store values
-        id_to_jobs[c_string + "1"];
-        id_to_jobs[c_string + "0"];
+    writer.put_vector(groups);
+    writer.put_vector(leaf_jobs);
+    writer.put_vector(leaf_waiting);
+    writer.put(waiting_count);
+    writer.put_vector(occupied_leaves);
+
+    writer.put(rebalance_interval);
+    writer.put(adds_since_rebalance);
+    writer.put_vector(p_window);
+    writer.put(p_window_size);
+    writer.put(p_window_next);
+    writer.put_vector(leaf_bounds);
+
+    writer.put(tune_interval);
+    writer.put(evaluation_weight);
+    writer.put(adds_since_tune);
+    writer.put(effective_levels);
+    writer.put(leaf_shift);
+    writer.put(split_evaluations);
+
+    jobs.write_image(writer);
+
+    writer.put(max_update);
+    writer.put(drift_threshold);
+    writer.put(drift_max_events);
+    writer.put(allocation_drift);
+    writer.put(events_since_realloc);
+    writer.put(history.size());
+    for (const auto &[job_id, servers] : history) {
+        writer.put(job_id);
+        writer.put(servers);
     }
+    writer.put_vector(realloc_stack);
+    writer.put_vector(staged_allocs);
+    writer.put(pass_update);
+}
+
+std::unique_ptr<RCGREEDY> RCGREEDY::restore(const char *image, size_t size) {
+    Image_Reader reader(image, size);
+    if (!reader.header(RCGREEDY_IMAGE, image_layout())) {
+        std::cerr << "Error restoring RCGREEDY, the image wasn't written by this build" << std::endl;
+        return nullptr;
+    }
+
+    size_t depth = 0, servers = 0, image_fanout = 0;
+    bool partial = false;
+    double constant = 0.0;
+    reader.get(depth);
+    reader.get(partial);
+    reader.get(servers);
+    reader.get(constant);
+    reader.get(image_fanout);
+    if (!reader.good() || depth > MAX_DEPTH || !(constant > 0.0) ||
+        (image_fanout != 2 && image_fanout != 4 && image_fanout != 8)) {
+        std::cerr << "Error restoring RCGREEDY, the image settings are invalid" << std::endl;
+        return nullptr;
+    }
+
+    // the constructor builds the empty tree of the right shape, the image then replaces its contents
+    auto rcg = std::make_unique<RCGREEDY>(servers, depth, 1.0 / constant, partial);
+    rcg->maximization_constant = constant;
+    if (image_fanout != 2) rcg->set_fanout(image_fanout);
+    const size_t group_count = rcg->groups.size();
+    const size_t leaf_count = rcg->leaf_jobs.size();
+    const size_t word_count = rcg->occupied_leaves.size();
+    reader.get(rcg->admission);
+
+    reader.get_vector(rcg->groups);
+    reader.get_vector(rcg->leaf_jobs);
+    reader.get_vector(rcg->leaf_waiting);
+    reader.get(rcg->waiting_count);
+    reader.get_vector(rcg->occupied_leaves);
+
+    reader.get(rcg->rebalance_interval);
+    reader.get(rcg->adds_since_rebalance);
+    reader.get_vector(rcg->p_window);
+    reader.get(rcg->p_window_size);
+    reader.get(rcg->p_window_next);
+    reader.get_vector(rcg->leaf_bounds);
+
+    reader.get(rcg->tune_interval);
+    reader.get(rcg->evaluation_weight);
+    reader.get(rcg->adds_since_tune);
+    reader.get(rcg->effective_levels);
+    reader.get(rcg->leaf_shift);
+    reader.get(rcg->split_evaluations);
 
+    bool pool_ok = rcg->jobs.read_image(reader);
+
+    reader.get(rcg->max_update);
+    reader.get(rcg->drift_threshold);
+    reader.get(rcg->drift_max_events);
+    reader.get(rcg->allocation_drift);
+    reader.get(rcg->events_since_realloc);
+    size_t history_size = 0;
+    reader.get(history_size);
+    for (size_t i = 0; i < history_size && reader.good(); ++i) {
+        std::pair<size_t, double> change;
+        reader.get(change.first);
+        reader.get(change.second);
+        rcg->history.push_back(change);
+    }
+    reader.get_vector(rcg->realloc_stack);
+    reader.get_vector(rcg->staged_allocs);
+    reader.get(rcg->pass_update);
+
+    bool consistent = reader.good() && pool_ok && rcg->groups.size() == group_count &&
+                      rcg->leaf_jobs.size() == leaf_count && rcg->leaf_waiting.size() == leaf_count &&
+                      rcg->occupied_leaves.size() == word_count && rcg->effective_levels <= rcg->levels &&
+                      rcg->leaf_shift == rcg->fanout_bits * (rcg->levels - rcg->effective_levels) &&
+                      (rcg->leaf_bounds.empty() || rcg->leaf_bounds.size() == leaf_count - 1) &&
+                      rcg->p_window_size <= rcg->p_window.size() &&
+                      (!rcg->rebalance_interval || rcg->p_window_next < rcg->p_window.size()) &&
+                      rcg->check_image();
+    if (!consistent) {
+        std::cerr << "Error restoring RCGREEDY, the image is truncated or inconsistent" << std::endl;
+        return nullptr;
+    }
+    return rcg;
 }
 
-std::string RCGREEDY::get_group_id(RCGREEDY_Job &job){
-    if (job_group_assignments.find(job) != job_group_assignments.end()) {
-        return job_group_assignments[job];
+bool RCGREEDY::check_image() const {
+    if (admission != Admission::ALL && (partial_servers || (admission != Admission::FCFS && admission != Admission::SMALLEST_P))) {
+        return false;
     }
-    double p_min = 0.0;
-    double p_max = 1.0;
-    double diff = .5;
-    std::string output = "";
 
-    for (size_t i = 0; i < current_depth; ++i) {
+    // every live job is in exactly one list, the admitted or waiting one of the leaf its record names
+    std::vector<char> seen;
+    size_t listed = 0, queued = 0;
+    for (size_t leaf = 0; leaf < leaf_jobs.size(); ++leaf) {
+        for (bool waiting : {false, true}) {
+            const Job_Pool::List &list = waiting ? leaf_waiting[leaf] : leaf_jobs[leaf];
+            if (!jobs.check_list(list, seen)) return false;
+            for (uint32_t slot = list.head; slot != Job_Pool::NONE; slot = jobs[slot].next) {
+                if (jobs[slot].leaf != leaf || jobs[slot].waiting != waiting) return false;
+            }
+            (waiting ? queued : listed) += list.size;
+        }
+        if (groups[first_leaf + leaf].job_count != leaf_jobs[leaf].size) return false;
+    }
+    if (listed + queued != jobs.size() || queued != waiting_count) return false;
+
+    // groups hold the jobs of their children
+    for (size_t group = 0; group < first_leaf; ++group) {
+        size_t children = 0;
+        for (size_t i = 1; i <= fanout; ++i) children += groups[fanout * group + i].job_count;
+        if (groups[group].job_count != children) return false;
+    }
 
-        if (job.p >= p_min + diff) {         // <-- WAS COMPARING TO p_min + diff
-            p_min += diff;
-            output += "1";
+    // a bit is set exactly for the leaves with jobs, none past the last leaf
+    for (size_t bit = 0; bit < occupied_leaves.size() * 64; ++bit) {
+        bool occupied = occupied_leaves[bit / 64] >> (bit % 64) & 1;
+        if (occupied != (bit < leaf_jobs.size() && leaf_jobs[bit].size)) return false;
+    }
+
+    for (const std::vector<Staged_Alloc> *allocs : {&realloc_stack, &staged_allocs}) {
+        for (const Staged_Alloc &alloc : *allocs) {
+            if (alloc.group >= groups.size()) return false;
+        }
+    }
+    return true;
+}
+
+bool RCGREEDY::save_snapshot(const std::string &path) const {
+    std::vector<char> image;
+    snapshot(image);
+    if (!write_image_file(path, image)) {
+        std::cerr << "Error writing snapshot " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<RCGREEDY> RCGREEDY::load_snapshot(const std::string &path) {
+    Mapped_File file(path);
+    if (!file.data()) {
+        std::cerr << "Error reading snapshot " << path << std::endl;
+        return nullptr;
+    }
+    return restore(file.data(), file.size());
+}
+
+void RCGREEDY::initalize_groups(){
+    levels = (current_depth + fanout_bits - 1) / fanout_bits;
+    effective_levels = levels;
+    leaf_shift = 0;
+    size_t leaf_count = size_t(1) << (fanout_bits * levels);
+    first_leaf = (leaf_count - 1) / (fanout - 1);
+    depth_ops = depth_dispatch[fanout_bits - 1][levels];
+
+    groups.assign(first_leaf + leaf_count, Group{0, 0, 0, 0.0});
+    groups[0] = Group{0, server_count, 0, 0.0};
+    leaf_jobs.assign(leaf_count, Job_Pool::List{});
+    leaf_waiting.assign(leaf_count, Job_Pool::List{});
+    occupied_leaves.assign((leaf_count + 63) / 64, 0);
+}
+
+void RCGREEDY::update_occupied(size_t leaf) {
+    uint64_t bit = uint64_t(1) << (leaf % 64);
+    if (leaf_jobs[leaf].size) {
+        occupied_leaves[leaf / 64] |= bit;
+    } else {
+        occupied_leaves[leaf / 64] &= ~bit;
+    }
+}
+
+size_t RCGREEDY::refresh_leaf(size_t leaf) {
+    size_t current_update = groups[0].update_count;
+    for (size_t depth = 0; depth <= levels; ++depth) {
+        Group &c_group = groups[leaf_ancestor(leaf, depth)];
+        if (c_group.update_count >= current_update) {
+            current_update = c_group.update_count;
         } else {
-            p_max -= diff;
-            output += "0";
+            // a group older than its ancestors holds no servers, see add_job
+            c_group.update_count = current_update;
+            c_group.allocated_servers = 0;
+        }
+    }
+    return groups[first_leaf + leaf].allocated_servers;
+}
+
+bool RCGREEDY::admit_waiting(size_t leaf) {
+    if (admission == Admission::ALL) return false;
+    Job_Pool::List &waiting = leaf_waiting[leaf];
+    Job_Pool::List &admitted_jobs = leaf_jobs[leaf];
+    const Group &leaf_group = groups[first_leaf + leaf];
+    const size_t room = std::max<size_t>(1, refresh_leaf(leaf));
+    bool admitted = false;
+
+    while (waiting.size && leaf_group.job_count < room) {
+        uint32_t slot = waiting.head;
+        if (admission == Admission::SMALLEST_P) {
+            for (uint32_t c_slot = jobs[slot].next; c_slot != Job_Pool::NONE; c_slot = jobs[c_slot].next) {
+                if (jobs[c_slot].p < jobs[slot].p) slot = c_slot;
+            }
+        }
+
+        jobs.unlink(waiting, slot);
+        jobs[slot].waiting = false;
+        jobs.link(admitted_jobs, slot);
+        waiting_count -= 1;
+
+        // the job joins its groups' statistics, which are used from the next reallocation on
+        double drift = 0.0;
+        for (size_t depth = 0; depth <= levels; ++depth) {
+            Group &c_group = groups[leaf_ancestor(leaf, depth)];
+            c_group.job_count += 1;
+            c_group.total_p += jobs[slot].p;
+            drift += 1.0 / c_group.job_count;
         }
-        diff /= 2;
+        allocation_drift += drift / (levels + 1);
+        admitted = true;
     }
 
-    // update assignments to avoid recomputation
-    job_group_assignments[job] = output;
-    return output;
+    // a reallocation that left fewer servers than admitted jobs sends the ones holding none back to
+    // the front of the queue, oldest first. They are at the back of the list (see get_group_server_count),
+    // so the jobs that keep a server keep the same one
+    if (admitted_jobs.size <= room) return admitted;
+    uint32_t slot = admitted_jobs.tail;
+    for (size_t excess = admitted_jobs.size - room; excess > 1; --excess) slot = jobs[slot].prev;
+    while (slot != Job_Pool::NONE) {
+        uint32_t next = jobs[slot].next;
+        jobs.unlink(admitted_jobs, slot);
+        jobs[slot].waiting = true;
+        jobs.link(waiting, slot);
+        waiting_count += 1;
+        history.push_back({jobs[slot].id, 0.0});
+
+        double drift = 0.0;
+        for (size_t depth = 0; depth <= levels; ++depth) {
+            Group &c_group = groups[leaf_ancestor(leaf, depth)];
+            drift += 1.0 / c_group.job_count;
+            c_group.job_count -= 1;
+            c_group.total_p -= jobs[slot].p;
+        }
+        allocation_drift += drift / (levels + 1);
+        slot = next;
+    }
+    return admitted;
 }
 
-void RCGREEDY::partial_realloc(const std::string &group){
-    
-    size_t depth = group.size();
+size_t RCGREEDY::get_leaf(double p) const {
+    return (full_depth_leaf(p) >> leaf_shift) << leaf_shift;
+}
+
+size_t RCGREEDY::full_depth_leaf(double p) const {
+    if (!leaf_bounds.empty()) {
+        return std::upper_bound(leaf_bounds.begin(), leaf_bounds.end(), p) - leaf_bounds.begin();
+    }
 
+    // splitting [0, 1] into fanout parts levels times only compares against dyadic
+    // rationals, so it is the same as taking the first fanout_bits * levels bits of p
+    double scaled = std::floor(p * static_cast<double>(leaf_jobs.size()));
+    if (!(scaled > 0.0)) return 0;
+    if (scaled >= static_cast<double>(leaf_jobs.size())) return leaf_jobs.size() - 1;
+    return static_cast<size_t>(scaled);
+}
+
+void RCGREEDY::partial_realloc(size_t group){
+    
     // update_count increase for group
     groups[group].update_count = max_update;
 
     // if at lowest point, reallocation was succesful and thus return
-    if (depth == current_depth) {
+    if (group >= first_leaf) {
+        admit_waiting(group - first_leaf);
         get_group_server_count(group, history); // add updates to history
         return;
     }
 
-    std::string group0 = group + "0";
-    std::string group1 = group + "1";
+    size_t child_servers[MAX_FANOUT];
+    split_group(groups, group, groups[group].allocated_servers, child_servers);
+    const size_t first_child = fanout * group + 1;
 
-    // if one group has no jobs, assign all jobs to the other group
-    if (!groups[group0].job_count && !groups[group1].job_count) {
-        groups[group0].allocated_servers = 0;
-        groups[group0].update_count = max_update;
-        groups[group1].allocated_servers = 0;
-        groups[group1].update_count = max_update;
-        return;
+    // allocate the servers, then continue below the children with jobs
+    for (size_t i = 0; i < fanout; ++i) {
+        groups[first_child + i].allocated_servers = child_servers[i];
+        groups[first_child + i].update_count = max_update;
+    }
+    for (size_t i = 0; i < fanout; ++i) {
+        if (groups[first_child + i].job_count) partial_realloc(first_child + i);
     }
-    else if (!groups[group0].job_count) {
-        groups[group1].allocated_servers = groups[group].allocated_servers;
-        groups[group0].allocated_servers = 0;
-        groups[group0].update_count = max_update;
-        return partial_realloc(group1);
-    } else if (!groups[group1].job_count) {
-        groups[group0].allocated_servers = groups[group].allocated_servers;
-        groups[group1].allocated_servers = 0;
-        groups[group1].update_count = max_update;
-        return partial_realloc(group0);
-    }
-
-    // generate optimal servers for the lower group via the GREEDY* formula
-    size_t a1 = optimal_server_count(groups[group0].total_p / groups[group0].job_count,
-                                     groups[group0].job_count, 
-                                     groups[group1].total_p / groups[group1].job_count,
-                                     groups[group1].job_count,
-                                     groups[group].allocated_servers);
-    
-    // allocate the servers
-    groups[group0].allocated_servers = a1;
-    groups[group1].allocated_servers = groups[group].allocated_servers - a1;
-    
-    partial_realloc(group0);
-    partial_realloc(group1);
 
     return;
-} 
+}
+
+void RCGREEDY::redistribute(size_t group) {
+    if (group >= first_leaf) {
+        admit_waiting(group - first_leaf);
+        get_group_server_count(group, history);
+        return;
+    }
+
+    size_t child_servers[MAX_FANOUT];
+    split_group(groups, group, groups[group].allocated_servers, child_servers);
+    const size_t first_child = fanout * group + 1;
+    const size_t current_update = groups[group].update_count;
+
+    for (size_t i = 0; i < fanout; ++i) {
+        Group &child = groups[first_child + i];
+
+        // a child older than its parent holds no servers (see add_job), and keeps it that way
+        // unless it gets some now, in which case its whole subtree is redone below
+        bool current = child.update_count >= current_update;
+        if (child_servers[i] == (current ? child.allocated_servers : 0)) continue;
+
+        child.allocated_servers = child_servers[i];
+        if (child.job_count) {
+            child.update_count = current_update;
+            redistribute(first_child + i);
+        } else {
+            // an empty child isn't descended into, a fresh update count makes the servers
+            // left below it stale, as partial_realloc does
+            child.update_count = ++max_update;
+        }
+    }
+}
+
+void RCGREEDY::split_group(const std::vector<Group> &tree, size_t group, size_t servers, size_t *child_servers) {
+    const size_t first_child = fanout * group + 1;
+    size_t occupied = 0;
+    size_t last_occupied = 0;
+    for (size_t i = 0; i < fanout; ++i) {
+        child_servers[i] = 0;
+        if (tree[first_child + i].job_count) {
+            occupied += 1;
+            last_occupied = i;
+        }
+    }
+
+    // if only one child has jobs, it gets every server
+    if (occupied <= 1) {
+        if (occupied) child_servers[last_occupied] = servers;
+        return;
+    }
+
+    if (fanout == 2) {
+        // generate optimal servers for the lower group via the GREEDY* formula
+        split_evaluations += servers + 1;
+        const Group &group0 = tree[first_child];
+        const Group &group1 = tree[first_child + 1];
+        child_servers[0] = optimal_server_count(group0.total_p / group0.job_count, group0.job_count,
+                                                group1.total_p / group1.job_count, group1.job_count,
+                                                servers);
+        child_servers[1] = servers - child_servers[0];
+        return;
+    }
+    split_evaluations += servers * occupied;
+    greedy_split(tree, first_child, servers, child_servers);
+}
+
+void RCGREEDY::greedy_split(const std::vector<Group> &tree, size_t first_child, size_t servers, size_t *child_servers) {
+    double p[MAX_FANOUT];
+    double job_count[MAX_FANOUT];
+    double current[MAX_FANOUT];     // objective term of each child with its servers so far
+    double next[MAX_FANOUT];        // and with one more server
 
+    // the objective term of a child is its job count times the speedup of its jobs
+    auto term = [&](size_t i, size_t a) {
+        return a ? job_count[i] * speedup_factor(p[i], a / job_count[i]) : 0.0;
+    };
+
+    size_t occupied[MAX_FANOUT];
+    size_t occupied_count = 0;
+    for (size_t i = 0; i < fanout; ++i) {
+        const Group &child = tree[first_child + i];
+        if (!child.job_count) continue;
+        job_count[i] = static_cast<double>(child.job_count);
+        p[i] = child.total_p / child.job_count;
+        current[i] = 0.0;
+        next[i] = term(i, 1);
+        occupied[occupied_count++] = i;
+    }
+
+    for (size_t server = 0; server < servers; ++server) {
+        size_t best = occupied[0];
+        for (size_t j = 1; j < occupied_count; ++j) {
+            size_t i = occupied[j];
+            if ((next[i] - current[i]) - (next[best] - current[best]) > EPSILON) best = i;
+        }
+        child_servers[best] += 1;
+        current[best] = next[best];
+        next[best] = term(best, child_servers[best] + 1);
+    }
+}
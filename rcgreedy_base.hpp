@@ -5,13 +5,17 @@
 #include <unordered_map>
 #include <algorithm>
 #include <utility>
-#include <unordered_set>
 #include <iostream>
+#include <memory>
+#include <string>
 #include <vector>
+#include "job_pool.hpp"
+#include "speedup_kernels.hpp"
 
 const double EPSILON = 1e-6; // used for floating point calculations
 class RCGREEDY {
     static constexpr size_t MAX_DEPTH = 10;  // maximum recursion depth of our scheduler 
+    static constexpr size_t MAX_FANOUT = 8;  // maximum number of children of a group
 
 public:
     struct RCGREEDY_Job {
@@ -29,14 +33,139 @@ public:
         }
     };
 
+    // order in which jobs waiting in a leaf's admission queue are admitted, see set_admission
+    enum class Admission {
+        ALL,            // no queue, every job is admitted on arrival
+        FCFS,           // earliest arrival first
+        SMALLEST_P      // least parallelizable job first
+    };
+
     RCGREEDY(size_t servers, size_t max_depth, double average_size, bool partial_server_allocs = false);
 
+    /*
+    * enables per leaf admission queues for whole server allocation. A leaf only admits jobs
+    * while it has fewer jobs than servers (and always admits at least one), the rest wait in
+    * its queue with no servers, outside of every group's statistics and reallocation, and are
+    * admitted in the given order as servers free up. A reallocation that leaves a leaf fewer
+    * servers than admitted jobs sends the ones left without a server back to the front of its
+    * queue, listed in the history at 0 servers. Jobs added to a queue are not put into the
+    * history until they are admitted. Must be set before any jobs are added
+    */
+    void set_admission(Admission order);
+
+    // returns the number of jobs waiting in admission queues
+    size_t get_waiting_count() const;
+
+    /*
+    * sets the number of children of every group (2, 4 or 8, default 2). Each level then
+    * classifies p by log2(fanout) bits, so the leaves still split p into 2^max_depth bins
+    * with max_depth / log2(fanout) levels (rounded up, giving finer bins if it doesn't divide).
+    * A group splits its servers among all of its children at once: the GREEDY* objective
+    * is concave in each child's servers, so they are handed out one at a time to the child
+    * gaining the most. A fanout of 2 keeps the binary split. Must be set before any jobs are added
+    */
+    void set_fanout(size_t fanout);
+
+    // returns the number of children of every group
+    size_t get_fanout() const;
+
+    /*
+    * enables quantile adaptive bins. The scheduler keeps the last window p values it has seen
+    * (from added jobs and update_job_p), and every rebalance_interval added jobs moves the leaf
+    * boundaries to the quantiles of that window, so clustered p values still spread evenly over
+    * the leaves. Every job is then moved to its new leaf in bulk and a full reallocation is
+    * performed. The history of the add that triggered it then holds every admitted job, along
+    * with any job the add or the reallocation sent back to its queue, at 0 servers. Until the
+    * first rebalance the bins split [0, 1] evenly. A rebalance_interval of 0 disables it. Must
+    * be set before any jobs are added
+    */
+    void set_adaptive_bins(size_t rebalance_interval, size_t window = 4096);
+
+    /*
+    * moves the leaf boundaries to the quantiles of the observed p values right away, see
+    * set_adaptive_bins. Does nothing if no p values have been observed
+    */
+    void rebalance_bins();
+
+    /*
+    * enables online depth selection. Every interval added jobs the scheduler predicts, for every
+    * depth from the root down to its leaves, the GREEDY* objective of a full reallocation that
+    * stops splitting at that depth and how many candidate splits it would evaluate (which is what
+    * a decision costs). It then moves to the depth with the highest relative objective gain over
+    * depth 0 minus evaluation_weight per evaluation, ties going to the shallower depth. A shallower
+    * effective depth merges leaves: every job shares the servers of the first leaf under its group
+    * at that depth, so the splits below it are trivial. Changing depth moves every job in bulk and
+    * performs a full reallocation, added to the history of the add that triggered it as with
+    * set_adaptive_bins. Depths count levels, so with a wider fanout each one covers
+    * log2(fanout) bits of p. An interval of 0 disables it. Must be set before any jobs are added
+    */
+    void set_auto_depth(size_t interval, double evaluation_weight = 1e-5);
+
+    /*
+    * runs the depth selection of set_auto_depth right away. Returns true if the depth changed
+    */
+    bool tune_depth();
+
+    // returns the depth jobs are currently grouped at, the tree's levels unless it was tuned
+    size_t get_effective_depth() const;
+
+    // returns the candidate splits evaluated by reallocations so far, depth predictions excluded
+    size_t get_split_evaluations() const;
+
+    /*
+    * preallocates storage for job_capacity live jobs, so that adding and deleting
+    * jobs does not allocate until that many jobs are in the scheduler at once
+    */
+    void reserve(size_t job_capacity);
+
     /*
     * performa a full reallocation of the entire system, based on the RCGREEDY
     * reallocation formula
     */
     void full_realloc();
 
+    /*
+    * enables the adaptive full reallocation policy. The scheduler accumulates how far
+    * group populations have drifted since the last full reallocation, and
+    * adaptive_realloc only reallocates once the drift reaches drift_threshold or
+    * max_events insertions/deletions have happened (0 means no event limit)
+    */
+    void set_adaptive_realloc(double drift_threshold, size_t max_events = 0);
+
+    /*
+    * performs a full reallocation if the adaptive policy calls for one.
+    * returns true if a reallocation was performed
+    */
+    bool adaptive_realloc();
+
+    // returns the allocation drift accumulated since the last full reallocation
+    double get_allocation_drift() const;
+
+    /*
+    * performs part of a full reallocation, splitting at most budget groups top-down.
+    * If no reallocation is in progress, a new one is started from the root. The previous
+    * allocation stays visible until every group has been processed; the new allocation 
+    * is then committed at once and the jobs whose allocation changed are put into the 
+    * history. Subtrees reallocated locally between steps, or whose groups gained their
+    * first or lost their last jobs during the pass, are split again at the commit with the
+    * current statistics. Returns true if a reallocation was committed during this call
+    */
+    bool realloc_step(size_t budget);
+
+    // returns true if a reallocation started by realloc_step has not been committed yet
+    bool realloc_in_progress() const;
+
+    /*
+    * changes the number of servers to servers without touching the jobs. The root gets the new
+    * count and its split is redone top-down, only descending into groups whose allocation
+    * changed, so only the jobs of leaves whose servers changed are put into the history. An
+    * incremental reallocation in progress is dropped, the next realloc_step starts over
+    */
+    void set_server_count(size_t servers);
+
+    // returns the number of servers being scheduled
+    size_t get_server_count() const;
+
     /*
     * add job Job to scheduler. If forced_local_realloc, when the job is added
     * if their are no servers allocated to it's current group, it forcefully 
@@ -49,6 +178,18 @@ public:
     * there are jobs
     */
     void delete_job(RCGREEDY_Job &Job, bool forced_local_realloc);
+
+    /*
+    * changes the speedup parameter of a job already in the scheduler to new_p (job.p is 
+    * updated too). Only groups below the lowest group shared by the old and new leaf change
+    * job counts, the shared ones only change total_p. If forced_local_realloc and the move
+    * leaves the old leaf without jobs or the new leaf without spare servers, that shared
+    * group is reallocated once, covering both leaves. Otherwise the jobs of both leaves are 
+    * put into the history. With admission queues, a waiting job, or one that would have to
+    * wait in its new leaf, is deleted and added again. The history then holds the changes of
+    * both, the job itself at 0 servers if it waits
+    */
+    void update_job_p(RCGREEDY_Job &job, double new_p, bool forced_local_realloc);
     /*
     * returns the server count allocated to any job. 
     * For large scale server allocation numbers, get_server_changes, 
@@ -69,11 +210,48 @@ public:
     */
     void get_all_server_count(std::vector<std::pair<size_t, double>> &input);
     
+    /*
+    * returns the index of the lowest level group (leaf) holding job, jobs with the same
+    * leaf share its servers. Returns -1 (as a size_t) if the job doesn't exist
+    */
+    size_t get_job_leaf(RCGREEDY_Job &job);
+
     /*
     * returns a vector of any jobs (as ids) and their allocations (as doubles) that have changed
     * in the last insertion/deletion or server update. 
     */
-    std::vector<std::pair<size_t, double>> get_server_changes();
+    const std::vector<std::pair<size_t, double>>& get_server_changes() const;
+
+    // returns the bytes of heap storage held by the scheduler
+    size_t memory_footprint() const;
+
+    /*
+    * appends the scheduler's full state to image: its settings, the group tree with its update
+    * counts, the leaf lists, the job records with their id table, and the adaptive and
+    * incremental reallocation state. See snapshot_image.hpp for the format
+    */
+    void snapshot(std::vector<char> &image) const;
+
+    /*
+    * builds a scheduler from an image written by snapshot. Arrays are copied back in bulk and
+    * the id table is adopted as it is, so no job is rehashed or relinked. The objective kernel
+    * is picked for this cpu again. Returns null if the image is truncated, inconsistent or was
+    * written by another build. Every index in the image is checked against the restored sizes,
+    * so a corrupt image is rejected rather than read out of bounds later
+    */
+    static std::unique_ptr<RCGREEDY> restore(const char *image, size_t size);
+
+    // snapshot into the file at path, replacing it only once the whole image is written
+    bool save_snapshot(const std::string &path) const;
+
+    // restore from the file at path, read through a memory mapping
+    static std::unique_ptr<RCGREEDY> load_snapshot(const std::string &path);
+
+    /*
+    * overrides the kernel optimal_server_count uses to evaluate candidate splits. 
+    * By default the fastest kernel supported by the cpu is picked at construction
+    */
+    void set_objective_kernel(Objective_Kernel kernel);
     /*
     * returns the speedup factor of any job with p as the speedup 
     * parameter and servers allocated servers
@@ -87,13 +265,6 @@ public:
 private:
 
 
-    // 'custom' hash function for mapping RCGREEDY_Jobs
-    struct Job_Hash {
-        size_t operator()(const RCGREEDY_Job& job) const {
-            return std::hash<size_t>{}(job.id);
-        }
-    };
-
     // groups of servers, lazyily updated
     struct Group {
         size_t job_count = 0;                   // total jobs in this group
@@ -102,48 +273,191 @@ private:
         double total_p = 0.0;                   // total p-value of all jobs within group
     };
 
-    std::unordered_map<std::string, Group> groups;                         // mapping of group id strings to their groups
-    std::unordered_map<std::string, std::unordered_set<RCGREEDY_Job, Job_Hash>> id_to_jobs; // mapping of group id strings to sorted vector of jobs in group, only for lowest group
-    std::unordered_map<RCGREEDY_Job, std::string, Job_Hash> job_group_assignments;   // maps jobs to their group id
+    // groups are stored as an implicit tree in level order: the root is group 0, and the
+    // children of group n are fanout * n + 1 (lowest p values) to fanout * n + fanout
+    std::vector<Group> groups;
+    std::vector<Job_Pool::List> leaf_jobs;  // jobs in each lowest level group (leaf), indexed by group - first_leaf
+    std::vector<Job_Pool::List> leaf_waiting;   // admission queue of each leaf, in arrival order
+    Admission admission = Admission::ALL;
+    size_t waiting_count = 0;
+    std::vector<uint64_t> occupied_leaves;      // bit set for every leaf with jobs (waiting jobs imply admitted ones)
+
+    // quantile adaptive bins, see set_adaptive_bins
+    size_t rebalance_interval = 0;              // 0 when the bins are fixed
+    size_t adds_since_rebalance = 0;
+    std::vector<double> p_window;               // ring buffer of the most recently observed p values
+    size_t p_window_size = 0;
+    size_t p_window_next = 0;
+    std::vector<double> leaf_bounds;            // leaf i holds p in [leaf_bounds[i - 1], leaf_bounds[i]), empty for even bins
+    std::vector<double> sorted_window;          // scratch space for rebalance_bins
+    std::vector<uint32_t> moved_slots;
+
+    // online depth selection, see set_auto_depth
+    size_t tune_interval = 0;                   // 0 when the depth is fixed
+    double evaluation_weight = 0.0;
+    size_t adds_since_tune = 0;
+    size_t effective_levels;                    // depth jobs are grouped at
+    size_t leaf_shift = 0;                      // low bits cleared from a leaf to merge it, fanout_bits * (levels - effective_levels)
+    size_t split_evaluations = 0;               // candidate splits evaluated by split_group so far
+    std::vector<Group> prediction_tree;         // scratch space for predict_depth
+    Job_Pool jobs;                          // every job in the scheduler, along with its leaf
+    size_t first_leaf;                      // group index of the first leaf
+    size_t fanout = 2;                      // children of every group
+    size_t fanout_bits = 1;                 // log2(fanout), bits of p classified per level
+    size_t levels;                          // depth of the leaves, current_depth / fanout_bits rounded up
 
     size_t server_count;
     
     size_t max_update = 0;            
+
+    // adaptive full reallocation state. Every insertion/deletion adds the relative change 
+    // in job count of each group on its path (averaged over the path) to allocation_drift
+    double drift_threshold = 0.0;       // 0 disables the adaptive policy
+    size_t drift_max_events = 0;        // events allowed between adaptive reallocs, 0 for no limit
+    double allocation_drift = 0.0;
+    size_t events_since_realloc = 0;
     double maximization_constant; // see GREEDY* optimization formula. 1/E(X), where X is the job size distribution
+    Objective_Kernel objective_kernel;  // evaluates the GREEDY* objective for batches of candidate splits
 
     
 
     std::vector<std::pair<size_t, double>> history; // vector containing recent (last insert/delete changes) server allocations
+    bool moving_job = false;                        // update_job_p is deleting and re-adding a job, add and delete append to history
 
-    // initalizes all mappings of strings to groups
+    // incremental reallocation state, see realloc_step
+    struct Staged_Alloc {
+        size_t group;
+        size_t servers;
+        bool pruned = false;        // group had no jobs when staged, so its subtree was skipped
+    };
+    std::vector<Staged_Alloc> realloc_stack;    // groups whose split has not been computed yet
+    std::vector<Staged_Alloc> staged_allocs;    // computed allocations, not visible until committed
+    size_t pass_update = 0;                     // max_update when the pass in progress began
+
+    // initalizes the group tree and leaf job lists
     void initalize_groups();
 
-    // recursive helper for initialize groups
-    void generate_mappings(double c_p_min, double c_p_max, std::string c_string, int remaining_depth);
+    // sizes of the structures snapshot writes raw, restore only accepts images with the same layout
+    static uint64_t image_layout();
+
+    // checks what restore read against this tree before anything walks it: the job lists and
+    // queues, the admission order, group job counts, occupied bits and staged groups
+    bool check_image() const;
+
+    // gets the server count for all elements in a leaf group
+    void get_group_server_count(size_t group, std::vector<std::pair<size_t, double>> &input);
+
+    // sets or clears the occupied bit of leaf from its job list
+    void update_occupied(size_t leaf);
+
+    // adds p to the adaptive bin window
+    void observe_p(double p);
 
-    // gets the server count for all elements in group
-    void get_group_server_count(const std::string &group, std::vector<std::pair<size_t, double>> &input);
+    // moves every job to the leaf its p maps to now, rebuilds the group statistics and reallocates,
+    // appending to the history
+    void migrate_jobs();
 
-    // gets smallest group id for any given job
-    std::string get_group_id(RCGREEDY_Job &job);
+    // rebalance_bins and tune_depth without starting a new history, for the add that triggers
+    // them. When both migrate the jobs, the history holds the changes of each
+    void rebalance_bins_impl();
+    bool tune_depth_impl();
+
+    // full_realloc without clearing the history
+    void realloc_all();
+
+    // predicts the objective and candidate evaluations of a full reallocation stopping at depth
+    void predict_depth(size_t depth, double &objective, size_t &evaluations);
+
+    // admits waiting jobs into leaf while it has servers to spare, and sends admitted jobs left
+    // without a server back to the queue (listing them in the history at 0 servers). Returns
+    // true if any were admitted
+    bool admit_waiting(size_t leaf);
+
+    // returns the servers of leaf, 0 if an ancestor was reallocated after it. Stale groups on
+    // the path are reset to 0 servers, as add_job does
+    size_t refresh_leaf(size_t leaf);
+
+    // gets the leaf (lowest level group, counted from 0) for a job with speedup parameter p
+    size_t get_leaf(double p) const;
+
+    // same as get_leaf, without merging leaves for the effective depth
+    size_t full_depth_leaf(double p) const;
+
+    // returns the group index of the ancestor of leaf at depth (depth 0 is the root)
+    inline size_t leaf_ancestor(size_t leaf, size_t depth) const {
+        return ((size_t(1) << (fanout_bits * depth)) - 1) / (fanout - 1) + (leaf >> (fanout_bits * (levels - depth)));
+    }
+
+    // the add_job / delete_job paths specialised on the tree depth (Levels) and log2 of the
+    // fanout (Bits), so level offsets are constants and the walks between the root and a
+    // leaf have a fixed trip count
+    template <size_t Levels, size_t Bits> void add_job_impl(RCGREEDY_Job &job, bool forced_local_realloc);
+    template <size_t Levels, size_t Bits> void delete_job_impl(RCGREEDY_Job &job, bool forced_local_realloc);
+
+    template <size_t Levels, size_t Bits> static constexpr size_t depth_first_leaf() {
+        return ((size_t(1) << (Bits * Levels)) - 1) / ((size_t(1) << Bits) - 1);
+    }
+    template <size_t Levels, size_t Bits> static constexpr size_t depth_ancestor(size_t leaf, size_t depth) {
+        return ((size_t(1) << (Bits * depth)) - 1) / ((size_t(1) << Bits) - 1) + (leaf >> (Bits * (Levels - depth)));
+    }
+    // same as get_leaf, floor(p * leaf count) clamped to the leaves
+    template <size_t Levels, size_t Bits> static size_t depth_leaf(double p) {
+        constexpr size_t leaves = size_t(1) << (Bits * Levels);
+        constexpr double leaf_count = static_cast<double>(leaves);
+        double scaled = std::floor(p * leaf_count);
+        if (!(scaled > 0.0)) return 0;
+        if (scaled >= leaf_count) return leaves - 1;
+        return static_cast<size_t>(scaled);
+    }
+
+    struct Depth_Ops {
+        void (RCGREEDY::*add_job)(RCGREEDY_Job &, bool);
+        void (RCGREEDY::*delete_job)(RCGREEDY_Job &, bool);
+    };
+    // indexed by fanout_bits - 1, then levels
+    static const Depth_Ops depth_dispatch[3][MAX_DEPTH + 1];
+    Depth_Ops depth_ops;            // the entry for the current tree, picked when it is built
 
     // reallocate from group downwards
-    void partial_realloc(const std::string &group); 
+    void partial_realloc(size_t group); 
+
+    // splits group's servers among its children again, only descending into the ones whose servers changed
+    void redistribute(size_t group);
+
+    /*
+    * splits servers among the children of group in tree (groups, or a tree laid out the same
+    * way), writing one count per child into child_servers. Children without jobs get none, a
+    * fanout of 2 uses optimal_server_count and wider fanouts greedy_split
+    */
+    void split_group(const std::vector<Group> &tree, size_t group, size_t servers, size_t *child_servers);
+
+    /*
+    * hands servers out one at a time to the child with jobs whose GREEDY* objective term
+    * grows the most, ties going to the less parallelizable child. Each term is concave in
+    * the child's servers, so this gives the optimal split
+    */
+    void greedy_split(const std::vector<Group> &tree, size_t first_child, size_t servers, size_t *child_servers);
 
     // returns the optimal number of servers to allocate to the less parallelizable class
     // p1 is the less parallelizable class
     inline size_t optimal_server_count(double p1, size_t jobs_count_1, double p2, size_t jobs_count_2, size_t total_servers) {
         size_t a1 = 0;
         double max_value = 0.0;
-        double current_value;
-    
-        for (size_t temp_a1 = 0; temp_a1 <= total_servers; ++temp_a1) {
-            current_value = maximization_constant * (jobs_count_1 * speedup_factor(p1, static_cast<double>(temp_a1) / jobs_count_1) + jobs_count_2 * speedup_factor(p2, static_cast<double>(total_servers - temp_a1) / jobs_count_2));
+        double values[OBJECTIVE_BATCH];
+        const Objective_Params params{maximization_constant, p1, static_cast<double>(jobs_count_1),
+                                      p2, static_cast<double>(jobs_count_2), static_cast<double>(total_servers)};
+
+        // evaluate candidates in batches, then scan them in order so ties break the same way
+        for (size_t first = 0; first <= total_servers; first += OBJECTIVE_BATCH) {
+            size_t count = std::min(OBJECTIVE_BATCH, total_servers - first + 1);
+            objective_kernel(params, first, count, values);
 
-            // if current value is greater than or equal to max value, take higher a1 value
-            if (max_value - current_value < EPSILON) {
-                a1 = temp_a1;
-                max_value = current_value;
+            for (size_t i = 0; i < count; ++i) {
+                // if current value is greater than or equal to max value, take higher a1 value
+                if (max_value - values[i] < EPSILON) {
+                    a1 = first + i;
+                    max_value = values[i];
+                }
             }
         }
 
@@ -0,0 +1,104 @@
+#include "reference_rcgreedy.hpp"
+#include "rcgreedy_base.hpp"
+#include <algorithm>
+#include <cmath>
+
+Reference_RCGREEDY::Reference_RCGREEDY(size_t servers, size_t depth, double average_size, bool partial_servers)
+    : servers(servers), depth(depth), maximization_constant(1 / average_size), partial_servers(partial_servers),
+      leaves(size_t(1) << depth) {}
+
+void Reference_RCGREEDY::add_job(size_t id, double p) {
+    job_p[id] = p;
+    leaves[leaf_of(p)].push_back(id);
+}
+
+void Reference_RCGREEDY::delete_job(size_t id) {
+    auto &leaf = leaves[leaf_of(job_p[id])];
+    leaf.erase(std::find(leaf.begin(), leaf.end(), id));
+    job_p.erase(id);
+}
+
+void Reference_RCGREEDY::update_job_p(size_t id, double new_p) {
+    size_t old_leaf = leaf_of(job_p[id]);
+    job_p[id] = new_p;
+
+    // a job staying in its leaf keeps its place
+    if (old_leaf == leaf_of(new_p)) return;
+    auto &leaf = leaves[old_leaf];
+    leaf.erase(std::find(leaf.begin(), leaf.end(), id));
+    leaves[leaf_of(new_p)].push_back(id);
+}
+
+void Reference_RCGREEDY::set_server_count(size_t count) {
+    servers = count;
+}
+
+std::vector<std::pair<size_t, double>> Reference_RCGREEDY::allocate() const {
+    std::vector<std::pair<size_t, double>> out;
+    if (!job_p.empty()) split(0, leaves.size(), servers, out);
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+size_t Reference_RCGREEDY::leaf_of(double p) const {
+    // the leaves split [0, 1] into equal bins, the top one including 1
+    double scaled = std::floor(p * leaves.size());
+    if (!(scaled > 0.0)) return 0;
+    return std::min(static_cast<size_t>(scaled), leaves.size() - 1);
+}
+
+void Reference_RCGREEDY::totals(size_t first, size_t last, size_t &count, double &total_p) const {
+    count = 0;
+    total_p = 0.0;
+    for (size_t leaf = first; leaf < last; ++leaf) {
+        for (size_t id : leaves[leaf]) {
+            count += 1;
+            total_p += job_p.at(id);
+        }
+    }
+}
+
+void Reference_RCGREEDY::split(size_t first, size_t last, size_t group_servers,
+                               std::vector<std::pair<size_t, double>> &out) const {
+    if (last - first == 1) {
+        const auto &ids = leaves[first];
+        size_t count = ids.size();
+        for (size_t i = 0; i < count; ++i) {
+            double share = partial_servers ? static_cast<double>(group_servers) / count
+                                           : static_cast<double>(group_servers / count + (i < group_servers % count));
+            out.push_back({ids[count - 1 - i], share});
+        }
+        return;
+    }
+
+    size_t middle = first + (last - first) / 2;
+    size_t count_1, count_2;
+    double total_1, total_2;
+    totals(first, middle, count_1, total_1);
+    totals(middle, last, count_2, total_2);
+
+    if (!count_2) return split(first, middle, group_servers, out);
+    if (!count_1) return split(middle, last, group_servers, out);
+
+    size_t servers_1 = best_split(total_1 / count_1, count_1, total_2 / count_2, count_2, group_servers);
+    split(first, middle, servers_1, out);
+    split(middle, last, group_servers - servers_1, out);
+}
+
+size_t Reference_RCGREEDY::best_split(double p1, size_t jobs_1, double p2, size_t jobs_2, size_t total) const {
+    auto speedup = [](double p, double servers) { return 1.0 / ((p / servers) + 1 - p); };
+    double n1 = static_cast<double>(jobs_1);
+    double n2 = static_cast<double>(jobs_2);
+
+    size_t best = 0;
+    double best_value = 0.0;
+    for (size_t a1 = 0; a1 <= total; ++a1) {
+        double a2 = static_cast<double>(total) - a1;
+        double value = maximization_constant * (n1 * speedup(p1, a1 / n1) + n2 * speedup(p2, a2 / n2));
+        if (best_value - value < EPSILON) {
+            best = a1;
+            best_value = value;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,62 @@
+#ifndef REFERENCE_RCGREEDY_HPP
+#define REFERENCE_RCGREEDY_HPP
+
+#include <cstddef>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/*
+* a deliberately plain model of RCGREEDY with a fanout of 2, fixed bins and no admission
+* queues, used as the oracle of the differential fuzzer. It keeps nothing but the jobs of
+* every leaf and, when asked, runs the GREEDY* recursion from scratch: a group with jobs in
+* both halves gives the lower p half the a1 servers maximizing
+*   (1/E(X)) * (n1 * speedup(p1, a1 / n1) + n2 * speedup(p2, (servers - a1) / n2)),
+* p1 and p2 being the mean p of each half, ties within EPSILON going to the larger a1, and a
+* group with jobs in one half only passes all of its servers down. A leaf splits its servers
+* evenly, or with whole servers gives the remainder one each to its most recently added jobs
+*/
+class Reference_RCGREEDY {
+public:
+    Reference_RCGREEDY(size_t servers, size_t depth, double average_size, bool partial_servers);
+
+    // the job must not be in the model
+    void add_job(size_t id, double p);
+
+    // the job must be in the model
+    void delete_job(size_t id);
+
+    // moves a job in the model to new_p, where it counts as just added to its leaf
+    void update_job_p(size_t id, double new_p);
+
+    void set_server_count(size_t servers);
+
+    bool contains(size_t id) const { return job_p.count(id) != 0; }
+    size_t job_count() const { return job_p.size(); }
+
+    /*
+    * returns the allocation of every job after a full reallocation, sorted by id
+    */
+    std::vector<std::pair<size_t, double>> allocate() const;
+
+private:
+    size_t servers;
+    size_t depth;
+    double maximization_constant;
+    bool partial_servers;
+    std::vector<std::vector<size_t>> leaves;    // ids in each leaf, most recently added last
+    std::unordered_map<size_t, double> job_p;
+
+    size_t leaf_of(double p) const;
+
+    // job count and summed p of leaves [first, last)
+    void totals(size_t first, size_t last, size_t &count, double &total_p) const;
+
+    // gives servers to the jobs of leaves [first, last), a group of the tree
+    void split(size_t first, size_t last, size_t servers, std::vector<std::pair<size_t, double>> &out) const;
+
+    // the a1 maximizing the GREEDY* objective, by trying every candidate
+    size_t best_split(double p1, size_t jobs_1, double p2, size_t jobs_2, size_t servers) const;
+};
+
+#endif // REFERENCE_RCGREEDY_HPP
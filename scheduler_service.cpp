@@ -0,0 +1,511 @@
+#include "scheduler_service.hpp"
+#include "event_generator.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <poll.h>
+#include <queue>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+Scheduler_Service::Scheduler_Service(size_t servers, size_t depth, bool partial_servers, size_t full_realloc_count)
+    : rcgreedy(servers, depth, 1.0, partial_servers), full_realloc_count(full_realloc_count),
+      realloc_counter(full_realloc_count) {}
+
+void Scheduler_Service::handle(const Service_Message& request, std::vector<Service_Message>& out) {
+    requests += 1;
+    RCGREEDY::RCGREEDY_Job job;
+    job.id = request.id;
+    job.p = request.value;
+
+    switch (request.type) {
+        case Service_Message::ADD:
+        case Service_Message::DELETE:
+            if (full_realloc_count && --realloc_counter == 0) {
+                rcgreedy.full_realloc();
+                publish_changes(out);
+                realloc_counter = full_realloc_count;
+            }
+            if (request.type == Service_Message::ADD) {
+                rcgreedy.add_job(job, true);
+            } else {
+                rcgreedy.delete_job(job, true);
+            }
+            publish_changes(out);
+            break;
+        case Service_Message::QUERY: {
+            Service_Message reply;
+            reply.type = Service_Message::ALLOCATION;
+            reply.id = request.id;
+            reply.value = rcgreedy.get_server_count(job);
+            out.push_back(reply);
+            break;
+        }
+        default:
+            std::cerr << "Error, unknown request type " << request.type << std::endl;
+            break;
+    }
+
+    if (request.end_of_batch) {
+        Service_Message ack;
+        ack.type = Service_Message::ACK;
+        ack.batch = request.batch;
+        ack.sent_ns = request.sent_ns;
+        out.push_back(ack);
+    }
+}
+
+size_t Scheduler_Service::get_request_count() const {
+    return requests;
+}
+
+size_t Scheduler_Service::get_change_count() const {
+    return changes;
+}
+
+void Scheduler_Service::publish_changes(std::vector<Service_Message>& out) {
+    for (const auto& [job_id, servers] : rcgreedy.get_server_changes()) {
+        Service_Message change;
+        change.type = Service_Message::CHANGE;
+        change.id = job_id;
+        change.value = servers;
+        out.push_back(change);
+    }
+    changes += rcgreedy.get_server_changes().size();
+}
+
+
+static std::string ring_name(const Service_Options& options, const char* direction, size_t client) {
+    return "/" + options.name + "-" + direction + "-" + std::to_string(client);
+}
+
+static std::string socket_path(const Service_Options& options) {
+    return "/tmp/" + options.name + ".sock";
+}
+
+static int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// writes every byte of data, returns false if the peer went away
+static bool write_all(int fd, const char* data, size_t size) {
+    while (size) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+static void print_summary(const Scheduler_Service& service, int64_t start_ns) {
+    double seconds = (now_ns() - start_ns) / 1e9;
+    std::cout << "served " << service.get_request_count() << " requests and published "
+              << service.get_change_count() << " changes in " << std::fixed << std::setprecision(3)
+              << seconds << " s (" << std::setprecision(0) << service.get_request_count() / seconds
+              << " decisions/s)" << std::endl;
+}
+
+static int serve_shm(Scheduler_Service& service, const Service_Options& options) {
+    std::vector<std::unique_ptr<Shm_Ring>> requests, responses;
+    for (size_t client = 0; client < options.clients; client++) {
+        requests.push_back(Shm_Ring::create(ring_name(options, "request", client), options.ring_capacity));
+        responses.push_back(Shm_Ring::create(ring_name(options, "response", client), options.ring_capacity));
+        if (!requests.back() || !responses.back()) return 1;
+    }
+    std::cout << "serving " << options.clients << " clients on /" << options.name << "-*" << std::endl;
+
+    // responses a client's ring can't take yet wait in its backlog, so a client that stops
+    // reading holds up only itself. It is dropped if it exits without disconnecting, or if its
+    // backlog makes no progress for client_timeout seconds
+    std::vector<bool> connected(options.clients, true);
+    std::vector<std::deque<Service_Message>> backlog(options.clients);
+    std::vector<int64_t> stalled_ns(options.clients, 0);
+    size_t remaining = options.clients;
+    auto drop = [&](size_t client, const char* reason) {
+        std::cerr << "Dropping client " << client << ", " << reason << std::endl;
+        connected[client] = false;
+        backlog[client].clear();
+        remaining -= 1;
+    };
+
+    const int64_t check_interval_ns = 100000000;
+    const int64_t timeout_ns = static_cast<int64_t>(options.client_timeout * 1e9);
+    int64_t next_check_ns = now_ns() + check_interval_ns;
+    std::vector<Service_Message> out;
+    int64_t start_ns = 0;
+    while (remaining) {
+        bool idle = true;
+        bool check = false;
+        if (now_ns() >= next_check_ns) {
+            check = true;
+            next_check_ns = now_ns() + check_interval_ns;
+        }
+        for (size_t client = 0; client < options.clients; client++) {
+            if (!connected[client]) continue;
+
+            auto& pending = backlog[client];
+            size_t before = pending.size();
+            while (!pending.empty() && responses[client]->push(pending.front())) pending.pop_front();
+            if (pending.size() != before) {
+                idle = false;
+                stalled_ns[client] = now_ns();
+            }
+            if (check && timeout_ns && !pending.empty() && now_ns() - stalled_ns[client] > timeout_ns) {
+                drop(client, "it left its responses unread");
+                continue;
+            }
+
+            // whatever a client sent before it exited is still served, up to its DISCONNECT
+            bool gone = check && requests[client]->peer_gone();
+
+            // a bounded run per client, so one busy client can't starve the rest, and none while
+            // its backlog is a ring long
+            size_t limit = pending.size() < options.ring_capacity ? 256 : 0;
+            Service_Message request;
+            for (size_t n = 0; (gone || n < limit) && requests[client]->pop(request); n++) {
+                if (!start_ns) start_ns = now_ns();
+                idle = false;
+                if (request.type == Service_Message::DISCONNECT) {
+                    connected[client] = false;
+                    remaining -= 1;
+                    break;
+                }
+                out.clear();
+                service.handle(request, out);
+                for (const auto& response : out) {
+                    if (!pending.empty() || !responses[client]->push(response)) {
+                        if (pending.empty()) stalled_ns[client] = now_ns();
+                        pending.push_back(response);
+                    }
+                }
+            }
+            if (gone && connected[client]) drop(client, "it exited without disconnecting");
+        }
+        if (idle) std::this_thread::yield();
+    }
+    print_summary(service, start_ns);
+    return 0;
+}
+
+static int serve_socket(Scheduler_Service& service, const Service_Options& options) {
+    std::string path = socket_path(options);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Error, socket path " << path << " is too long" << std::endl;
+        return 1;
+    }
+    std::strcpy(address.sun_path, path.c_str());
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path.c_str());
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listener, options.clients) != 0) {
+        std::cerr << "Error listening on " << path << ": " << std::strerror(errno) << std::endl;
+        if (listener >= 0) close(listener);
+        return 1;
+    }
+    std::cout << "serving " << options.clients << " clients on " << path << std::endl;
+
+    // fds[0] is the listener, every connection keeps the bytes of its last partial message
+    std::vector<pollfd> fds = {{listener, POLLIN, 0}};
+    std::vector<std::string> pending(1);
+    size_t accepted = 0, remaining = options.clients;
+    std::vector<Service_Message> out;
+    std::vector<char> buffer(1 << 16);
+    int64_t start_ns = 0;
+
+    while (remaining) {
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "Error polling connections: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        if ((fds[0].revents & POLLIN) && accepted < options.clients) {
+            int connection = accept(listener, nullptr, nullptr);
+            if (connection >= 0) {
+                fds.push_back({connection, POLLIN, 0});
+                pending.emplace_back();
+                accepted += 1;
+            }
+            if (accepted == options.clients) fds[0].events = 0;
+        }
+
+        for (size_t i = 1; i < fds.size(); i++) {
+            if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            ssize_t received = read(fds[i].fd, buffer.data(), buffer.size());
+            if (received < 0 && errno == EINTR) continue;
+
+            bool disconnected = received <= 0;
+            if (!disconnected) {
+                if (!start_ns) start_ns = now_ns();
+                pending[i].append(buffer.data(), received);
+                size_t whole = pending[i].size() / sizeof(Service_Message) * sizeof(Service_Message);
+                out.clear();
+                for (size_t offset = 0; offset < whole && !disconnected; offset += sizeof(Service_Message)) {
+                    Service_Message request;
+                    std::memcpy(&request, pending[i].data() + offset, sizeof(request));
+                    if (request.type == Service_Message::DISCONNECT) {
+                        disconnected = true;
+                    } else {
+                        service.handle(request, out);
+                    }
+                }
+                pending[i].erase(0, whole);
+                if (!write_all(fds[i].fd, reinterpret_cast<const char*>(out.data()), out.size() * sizeof(Service_Message))) {
+                    disconnected = true;
+                }
+            }
+
+            if (disconnected) {
+                close(fds[i].fd);
+                fds.erase(fds.begin() + i);
+                pending.erase(pending.begin() + i);
+                remaining -= 1;
+                i -= 1;
+            }
+        }
+    }
+    close(listener);
+    unlink(path.c_str());
+    print_summary(service, start_ns);
+    return 0;
+}
+
+int run_daemon(const Service_Options& options) {
+    Scheduler_Service service(options.servers, options.depth, options.partial_servers, options.full_realloc_count);
+    return options.use_socket ? serve_socket(service, options) : serve_shm(service, options);
+}
+
+
+// the client end of either transport
+class Service_Link {
+public:
+    virtual ~Service_Link() = default;
+    virtual void send(const Service_Message& message) = 0;
+    virtual void flush() {}
+    // waits for the next response, returns false if the daemon went away
+    virtual bool receive(Service_Message& message) = 0;
+};
+
+class Shm_Link : public Service_Link {
+public:
+    Shm_Link(std::unique_ptr<Shm_Ring> requests, std::unique_ptr<Shm_Ring> responses)
+        : requests(std::move(requests)), responses(std::move(responses)) {}
+
+    // while the request ring is full, responses are set aside so the daemon never blocks on us
+    void send(const Service_Message& message) override {
+        while (!requests->push(message)) {
+            Service_Message response;
+            while (responses->pop(response)) backlog.push_back(response);
+            std::this_thread::yield();
+        }
+    }
+
+    bool receive(Service_Message& message) override {
+        if (!backlog.empty()) {
+            message = backlog.front();
+            backlog.pop_front();
+            return true;
+        }
+        while (!responses->pop(message)) std::this_thread::yield();
+        return true;
+    }
+
+private:
+    std::unique_ptr<Shm_Ring> requests;
+    std::unique_ptr<Shm_Ring> responses;
+    std::deque<Service_Message> backlog;
+};
+
+class Socket_Link : public Service_Link {
+public:
+    explicit Socket_Link(int fd) : fd(fd) {}
+    ~Socket_Link() override { close(fd); }
+
+    void send(const Service_Message& message) override {
+        outgoing.append(reinterpret_cast<const char*>(&message), sizeof(message));
+    }
+
+    // writes without blocking and reads what arrives meanwhile, so a batch larger than the
+    // socket buffers can't deadlock against the daemon writing its responses
+    void flush() override {
+        size_t sent = 0;
+        while (sent < outgoing.size()) {
+            pollfd state{fd, POLLIN | POLLOUT, 0};
+            if (poll(&state, 1, -1) < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            if ((state.revents & POLLIN) && !read_some()) break;
+            if (state.revents & POLLOUT) {
+                ssize_t written = ::send(fd, outgoing.data() + sent, outgoing.size() - sent, MSG_DONTWAIT);
+                if (written < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+                if (written <= 0) break;
+                sent += written;
+            }
+            if (state.revents & (POLLHUP | POLLERR)) break;
+        }
+        outgoing.clear();
+    }
+
+    bool receive(Service_Message& message) override {
+        while (incoming.size() - consumed < sizeof(message)) {
+            if (!read_some()) return false;
+        }
+        std::memcpy(&message, incoming.data() + consumed, sizeof(message));
+        consumed += sizeof(message);
+        return true;
+    }
+
+private:
+    int fd;
+    std::string outgoing;
+    std::string incoming;
+    size_t consumed = 0;
+
+    // appends whatever the daemon sent, returns false if it went away
+    bool read_some() {
+        char buffer[1 << 14];
+        ssize_t received;
+        do {
+            received = read(fd, buffer, sizeof(buffer));
+        } while (received < 0 && errno == EINTR);
+        if (received <= 0) return false;
+        incoming.erase(0, consumed);
+        consumed = 0;
+        incoming.append(buffer, received);
+        return true;
+    }
+};
+
+// connects to the daemon, retrying for a few seconds while it starts up
+static std::unique_ptr<Service_Link> connect_daemon(const Service_Options& options) {
+    for (int attempt = 0; attempt < 500; attempt++) {
+        if (options.use_socket) {
+            sockaddr_un address{};
+            address.sun_family = AF_UNIX;
+            std::string path = socket_path(options);
+            std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+            int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+                return std::make_unique<Socket_Link>(fd);
+            }
+            if (fd >= 0) close(fd);
+        } else {
+            auto requests = Shm_Ring::attach(ring_name(options, "request", options.client));
+            auto responses = Shm_Ring::attach(ring_name(options, "response", options.client));
+            if (requests && responses) return std::make_unique<Shm_Link>(std::move(requests), std::move(responses));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::cerr << "Error, no daemon serving " << options.name << std::endl;
+    return nullptr;
+}
+
+/*
+* the request stream of a client: every arrival adds its job after deleting the jobs whose
+* size has passed since they were added, then the jobs still running are deleted
+*/
+static std::vector<Service_Message> build_requests(const Service_Options& options) {
+    auto events = generate_events(options.jobs, options.arrival_lambda, options.job_size_lambda, options.seed);
+    using Departure = std::pair<long double, uint64_t>;
+    std::priority_queue<Departure, std::vector<Departure>, std::greater<Departure>> departures;
+
+    std::vector<Service_Message> requests;
+    uint64_t next_id = options.client * options.jobs;
+    size_t adds = 0;
+    auto push = [&](Service_Message::Type type, uint64_t id, double p) {
+        Service_Message request;
+        request.type = type;
+        request.id = id;
+        request.value = p;
+        requests.push_back(request);
+        if (type == Service_Message::ADD && options.query_every && ++adds % options.query_every == 0) {
+            request.type = Service_Message::QUERY;
+            requests.push_back(request);
+        }
+    };
+
+    while (!events.empty()) {
+        Event event = events.top();
+        events.pop();
+        while (!departures.empty() && departures.top().first <= event.event_time) {
+            push(Service_Message::DELETE, departures.top().second, 0.0);
+            departures.pop();
+        }
+        push(Service_Message::ADD, next_id, event.job.p);
+        departures.push({event.event_time + event.job.size, next_id});
+        next_id += 1;
+    }
+    while (!departures.empty()) {
+        push(Service_Message::DELETE, departures.top().second, 0.0);
+        departures.pop();
+    }
+    return requests;
+}
+
+int run_loadgen(const Service_Options& options) {
+    std::vector<Service_Message> requests = build_requests(options);
+    std::unique_ptr<Service_Link> link = connect_daemon(options);
+    if (!link) return 1;
+
+    size_t batch_size = std::max<size_t>(options.batch, 1);
+    std::vector<int64_t> latencies;
+    latencies.reserve(requests.size() / batch_size + 1);
+    size_t changes = 0;
+    int64_t start_ns = now_ns();
+
+    for (size_t first = 0, batch = 0; first < requests.size(); first += batch_size, batch++) {
+        size_t last = std::min(first + batch_size, requests.size());
+        int64_t sent_ns = now_ns();
+        for (size_t i = first; i < last; i++) {
+            Service_Message request = requests[i];
+            request.batch = batch;
+            request.sent_ns = sent_ns;
+            request.end_of_batch = i + 1 == last;
+            link->send(request);
+        }
+        link->flush();
+
+        Service_Message response;
+        while (true) {
+            if (!link->receive(response)) {
+                std::cerr << "Error, the daemon closed the connection" << std::endl;
+                return 1;
+            }
+            if (response.type == Service_Message::CHANGE) changes += 1;
+            if (response.type == Service_Message::ACK && response.batch == batch) break;
+        }
+        latencies.push_back(now_ns() - response.sent_ns);
+    }
+    double seconds = (now_ns() - start_ns) / 1e9;
+
+    Service_Message disconnect;
+    disconnect.type = Service_Message::DISCONNECT;
+    link->send(disconnect);
+    link->flush();
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double q) {
+        if (latencies.empty()) return 0.0;
+        return latencies[std::min(latencies.size() - 1, static_cast<size_t>(q * latencies.size()))] / 1e3;
+    };
+    std::cout << "client " << options.client << " (" << (options.use_socket ? "socket" : "shared memory") << "): "
+              << requests.size() << " requests in " << latencies.size() << " batches of " << batch_size << ", "
+              << changes << " changes, " << std::fixed << std::setprecision(3) << seconds << " s, "
+              << std::setprecision(0) << requests.size() / seconds << " decisions/s\n"
+              << "batch round trip (us): p50 " << std::setprecision(1) << percentile(0.5)
+              << ", p99 " << percentile(0.99) << ", p99.9 " << percentile(0.999)
+              << ", max " << percentile(1.0) << std::endl;
+    return 0;
+}
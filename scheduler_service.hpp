@@ -0,0 +1,76 @@
+#ifndef SCHEDULER_SERVICE_HPP
+#define SCHEDULER_SERVICE_HPP
+
+#include "rcgreedy_base.hpp"
+#include "shm_ring.hpp"
+#include <string>
+#include <vector>
+
+// settings of the scheduler daemon and the load generator, both sides must agree on the transport
+struct Service_Options {
+    // client c sends on the shared memory ring /<name>-request-<c> and reads /<name>-response-<c>,
+    // or with use_socket every client connects to the unix socket /tmp/<name>.sock
+    std::string name = "rcgreedy";
+    size_t clients = 1;             // the daemon exits once this many clients have disconnected
+    bool use_socket = false;
+    size_t ring_capacity = 65536;   // messages per ring
+
+    // daemon
+    size_t servers = 1000;
+    size_t depth = 5;
+    bool partial_servers = true;
+    size_t full_realloc_count = 10; // requests between full reallocations, 0 never runs one
+    double client_timeout = 10.0;   // seconds a client may leave its responses unread before it is dropped, 0 never drops one
+
+    // load generator
+    size_t client = 0;              // which client this is, job ids start at client * jobs
+    size_t jobs = 100000;
+    size_t batch = 16;              // requests per batch, the next batch is sent once this one is acknowledged
+    double arrival_lambda = 1.0;
+    double job_size_lambda = 0.01;  // a job is deleted job size time units after it was added
+    unsigned seed = 1;
+    size_t query_every = 0;         // if > 0, every query_every-th added job is queried right after its ADD
+};
+
+
+/*
+* the transport independent part of the daemon: one RCGREEDY instance answering requests
+*/
+class Scheduler_Service {
+public:
+    Scheduler_Service(size_t servers, size_t depth, bool partial_servers, size_t full_realloc_count);
+
+    /*
+    * applies one request and appends its responses to out: a CHANGE for every allocation it
+    * changed (including those of a full reallocation it triggered), an ALLOCATION for a
+    * query, then an ACK if the request ends a batch. DISCONNECT is left to the transport
+    */
+    void handle(const Service_Message& request, std::vector<Service_Message>& out);
+
+    size_t get_request_count() const;
+    size_t get_change_count() const;
+
+private:
+    RCGREEDY rcgreedy;
+    size_t full_realloc_count;
+    size_t realloc_counter;
+    size_t requests = 0;
+    size_t changes = 0;
+
+    void publish_changes(std::vector<Service_Message>& out);
+};
+
+
+/*
+* runs the scheduler daemon until every client has disconnected or been dropped (shared memory
+* clients only, see client_timeout), returns the exit code
+*/
+int run_daemon(const Service_Options& options);
+
+/*
+* replays generate_events against a running daemon as add and delete batches, then prints
+* the decisions per second and the batch round trip latency percentiles. Returns the exit code
+*/
+int run_loadgen(const Service_Options& options);
+
+#endif // SCHEDULER_SERVICE_HPP
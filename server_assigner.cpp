@@ -0,0 +1,105 @@
+#include "server_assigner.hpp"
+
+Server_Assigner::Server_Assigner(size_t servers) : free_bits((servers + 63) / 64, ~uint64_t(0)), free_servers(servers) {
+    // clear the bits past the last server
+    if (servers % 64) free_bits.back() = (uint64_t(1) << (servers % 64)) - 1;
+}
+
+const std::vector<Server_Assigner::Move>& Server_Assigner::apply(const std::vector<std::pair<size_t, double>>& changes) {
+    moves.clear();
+    released.clear();
+    targets.clear();
+    target_index.clear();
+
+    // keep the last count of every job
+    for (const auto& [job_id, servers] : changes) {
+        size_t count = servers > 0.0 ? static_cast<size_t>(servers) : 0;
+        auto [it, inserted] = target_index.try_emplace(job_id, targets.size());
+        if (inserted) {
+            targets.push_back({job_id, count});
+        } else {
+            targets[it->second].second = count;
+        }
+    }
+
+    // shrinking jobs release their most recently taken servers first
+    for (const auto& [job_id, count] : targets) {
+        auto it = held.find(job_id);
+        if (it == held.end()) continue;
+        std::vector<size_t>& servers = it->second;
+        while (servers.size() > count) {
+            released.push_back({servers.back(), job_id, NO_JOB});
+            servers.pop_back();
+        }
+    }
+
+    // growing jobs take released servers directly, then from the free pool
+    for (const auto& [job_id, count] : targets) {
+        if (count == 0) {
+            held.erase(job_id);
+            continue;
+        }
+        std::vector<size_t>& servers = held[job_id];
+        while (servers.size() < count) {
+            if (!released.empty()) {
+                Move move = released.back();
+                released.pop_back();
+                move.to = job_id;
+                servers.push_back(move.server);
+                moves.push_back(move);
+                transfers += 1;
+            } else if (free_servers) {
+                servers.push_back(take_free());
+                moves.push_back({servers.back(), NO_JOB, job_id});
+            } else {
+                std::cerr << "Error assigning servers to job " << job_id << ". No free servers" << std::endl;
+                break;
+            }
+        }
+    }
+
+    // anything left over goes back to the pool
+    for (const Move& move : released) {
+        give_back(move.server);
+        moves.push_back(move);
+    }
+    return moves;
+}
+
+const std::vector<Server_Assigner::Move>& Server_Assigner::remove_job(size_t job_id) {
+    moves.clear();
+    auto it = held.find(job_id);
+    if (it == held.end()) return moves;
+
+    for (size_t server : it->second) {
+        give_back(server);
+        moves.push_back({server, job_id, NO_JOB});
+    }
+    held.erase(it);
+    return moves;
+}
+
+const std::vector<size_t>& Server_Assigner::get_servers(size_t job_id) const {
+    static const std::vector<size_t> none;
+    auto it = held.find(job_id);
+    return it == held.end() ? none : it->second;
+}
+
+size_t Server_Assigner::free_count() const {
+    return free_servers;
+}
+
+size_t Server_Assigner::take_free() {
+    while (!free_bits[next_free_word]) next_free_word += 1;
+    uint64_t &word = free_bits[next_free_word];
+    size_t bit = __builtin_ctzll(word);
+    word &= word - 1;
+    free_servers -= 1;
+    return next_free_word * 64 + bit;
+}
+
+void Server_Assigner::give_back(size_t server) {
+    free_bits[server / 64] |= uint64_t(1) << (server % 64);
+    free_servers += 1;
+    if (server / 64 < next_free_word) next_free_word = server / 64;
+}
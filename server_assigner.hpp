@@ -0,0 +1,72 @@
+#ifndef SERVER_ASSIGNER_HPP
+#define SERVER_ASSIGNER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/*
+* maps the server counts a scheduler hands out onto concrete server ids. Each job keeps the
+* servers it already holds as long as its count doesn't shrink, so an allocation change only
+* moves as many servers as the counts require: servers released by shrinking jobs are handed
+* directly to growing jobs, and only the rest go through the free pool (a bitmap). Meant for
+* whole server allocation, fractional counts are rounded down
+*/
+class Server_Assigner {
+public:
+    static constexpr size_t NO_JOB = static_cast<size_t>(-1);
+
+    // a server changing owner, from or to is NO_JOB for the free pool
+    struct Move {
+        size_t server;
+        size_t from;
+        size_t to;
+    };
+
+    explicit Server_Assigner(size_t servers);
+
+    /*
+    * brings every job in changes (pairs of job ids and server counts, as returned by the
+    * schedulers) to its new count and returns the servers that moved. Jobs not in changes
+    * keep their servers, if a job appears more than once its last count is used
+    */
+    const std::vector<Move>& apply(const std::vector<std::pair<size_t, double>>& changes);
+
+    /*
+    * returns every server held by job_id to the free pool, and the moves this made
+    */
+    const std::vector<Move>& remove_job(size_t job_id);
+
+    // returns the ids of the servers held by job_id
+    const std::vector<size_t>& get_servers(size_t job_id) const;
+
+    // returns the number of servers not held by any job
+    size_t free_count() const;
+
+    // returns how many servers went straight from one job to another, over every call so far.
+    // Moves to or from the free pool aren't counted
+    size_t transfer_count() const { return transfers; }
+
+private:
+    std::vector<uint64_t> free_bits;    // bit i is set if server i is free
+    size_t free_servers;
+    size_t next_free_word = 0;          // no free server below this word
+    size_t transfers = 0;
+
+    std::unordered_map<size_t, std::vector<size_t>> held;  // servers of each job, in the order they were taken
+    std::vector<Move> moves;
+
+    // scratch space for apply, kept to avoid reallocating every call
+    std::vector<std::pair<size_t, size_t>> targets;
+    std::unordered_map<size_t, size_t> target_index;
+    std::vector<Move> released;
+
+    // takes the lowest free server, there must be one
+    size_t take_free();
+    void give_back(size_t server);
+};
+
+#endif // SERVER_ASSIGNER_HPP
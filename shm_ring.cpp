@@ -0,0 +1,118 @@
+#include "shm_ring.hpp"
+#include <fcntl.h>
+#include <iostream>
+#include <new>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+Shm_Ring::Shm_Ring(const std::string& name, int fd, void* memory, size_t bytes, bool owner)
+    : name(name), fd(fd), memory(memory), bytes(bytes), owner(owner), header(static_cast<Header*>(memory)),
+      slots(reinterpret_cast<Service_Message*>(static_cast<char*>(memory) + sizeof(Header))) {
+    cached_head = header->head.load(std::memory_order_acquire);
+    cached_tail = header->tail.load(std::memory_order_acquire);
+}
+
+std::unique_ptr<Shm_Ring> Shm_Ring::create(const std::string& name, size_t capacity) {
+    size_t slot_count = 1;
+    while (slot_count < capacity) slot_count <<= 1;
+    size_t bytes = sizeof(Header) + slot_count * sizeof(Service_Message);
+
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        std::cerr << "Error creating shared memory ring " << name << std::endl;
+        return nullptr;
+    }
+    if (ftruncate(fd, bytes) != 0) {
+        std::cerr << "Error sizing shared memory ring " << name << std::endl;
+        close(fd);
+        shm_unlink(name.c_str());
+        return nullptr;
+    }
+    void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED) {
+        std::cerr << "Error mapping shared memory ring " << name << std::endl;
+        close(fd);
+        shm_unlink(name.c_str());
+        return nullptr;
+    }
+
+    // the segment starts zeroed, ready is published last so attaching sees a whole header
+    Header* header = new (memory) Header();
+    header->mask = slot_count - 1;
+    header->head.store(0, std::memory_order_relaxed);
+    header->tail.store(0, std::memory_order_relaxed);
+    header->attached.store(0, std::memory_order_relaxed);
+    header->ready.store(1, std::memory_order_release);
+    return std::unique_ptr<Shm_Ring>(new Shm_Ring(name, fd, memory, bytes, true));
+}
+
+std::unique_ptr<Shm_Ring> Shm_Ring::attach(const std::string& name) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0600);
+    if (fd < 0) return nullptr;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(Header)) {
+        close(fd);
+        return nullptr;
+    }
+    size_t bytes = info.st_size;
+    void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED) {
+        close(fd);
+        return nullptr;
+    }
+
+    Header* header = static_cast<Header*>(memory);
+    if (header->ready.load(std::memory_order_acquire) != 1 ||
+        sizeof(Header) + (header->mask + 1) * sizeof(Service_Message) > bytes || flock(fd, LOCK_SH) != 0) {
+        munmap(memory, bytes);
+        close(fd);
+        return nullptr;
+    }
+    header->attached.store(1, std::memory_order_release);
+    return std::unique_ptr<Shm_Ring>(new Shm_Ring(name, fd, memory, bytes, false));
+}
+
+Shm_Ring::~Shm_Ring() {
+    munmap(memory, bytes);
+    close(fd);
+    if (owner) shm_unlink(name.c_str());
+}
+
+bool Shm_Ring::push(const Service_Message& message) {
+    uint64_t tail = header->tail.load(std::memory_order_relaxed);
+    if (tail - cached_head > header->mask) {
+        cached_head = header->head.load(std::memory_order_acquire);
+        if (tail - cached_head > header->mask) return false;
+    }
+    slots[tail & header->mask] = message;
+    header->tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+bool Shm_Ring::pop(Service_Message& message) {
+    uint64_t head = header->head.load(std::memory_order_relaxed);
+    if (head == cached_tail) {
+        cached_tail = header->tail.load(std::memory_order_acquire);
+        if (head == cached_tail) return false;
+    }
+    message = slots[head & header->mask];
+    header->head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+size_t Shm_Ring::capacity() const {
+    return header->mask + 1;
+}
+
+bool Shm_Ring::peer_gone() const {
+    if (!header->attached.load(std::memory_order_acquire)) return false;
+
+    // the lock is released when the peer destroys its ring or exits, however it exits
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) return false;
+    flock(fd, LOCK_UN);
+    return true;
+}
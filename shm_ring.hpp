@@ -0,0 +1,94 @@
+#ifndef SHM_RING_HPP
+#define SHM_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/*
+* one request to or response from the scheduler service, the same 40 bytes on the
+* shared memory rings and on the socket
+*/
+struct Service_Message {
+    enum Type : uint32_t {
+        ADD,            // request: add job id with p = value
+        DELETE,         // request: delete job id
+        QUERY,          // request: reply ALLOCATION with the servers of job id
+        DISCONNECT,     // request: the client is done, no reply
+        CHANGE,         // response: job id now holds value servers
+        ALLOCATION,     // response: the servers of a queried job, -1 if it doesn't exist
+        ACK             // response: every request of batch has been applied
+    };
+
+    uint32_t type = ADD;
+    uint32_t end_of_batch = 0;  // requests: the service sends the batch's ACK after this one
+    uint64_t id = 0;
+    double value = 0.0;
+    uint64_t batch = 0;         // echoed in the ACK
+    int64_t sent_ns = 0;        // client clock when the batch was sent, echoed in the ACK
+};
+static_assert(sizeof(Service_Message) == 40, "Service_Message is a wire format");
+
+
+/*
+* single producer single consumer ring of Service_Messages in a POSIX shared memory segment.
+* The producer only writes tail and the consumer only writes head, each on its own cache
+* line, and each side caches the other's index so a push or pop only reads the shared
+* index when the ring looks full or empty. Several producers use one ring each
+*/
+class Shm_Ring {
+public:
+    /*
+    * creates the segment name (which starts with '/'), replacing a stale one, with room for
+    * capacity messages rounded up to a power of two. The segment is unlinked when the returned
+    * ring is destroyed. Returns null on failure
+    */
+    static std::unique_ptr<Shm_Ring> create(const std::string& name, size_t capacity);
+
+    /*
+    * maps a segment made by create, returns null if it doesn't exist or isn't set up yet. The
+    * attaching process holds a shared lock on the segment until the ring is destroyed or the
+    * process exits, which is how the creator tells it is gone
+    */
+    static std::unique_ptr<Shm_Ring> attach(const std::string& name);
+
+    ~Shm_Ring();
+    Shm_Ring(const Shm_Ring&) = delete;
+    Shm_Ring& operator=(const Shm_Ring&) = delete;
+
+    // producer side, returns false if the ring is full
+    bool push(const Service_Message& message);
+
+    // consumer side, returns false if the ring is empty
+    bool pop(Service_Message& message);
+
+    size_t capacity() const;
+
+    // creator side, true once a process attached the ring and has since let go of it
+    bool peer_gone() const;
+
+private:
+    struct Header {
+        std::atomic<uint64_t> ready;    // set once the creator has initialised the header
+        std::atomic<uint64_t> attached; // set once a process has attached and holds its lock
+        uint64_t mask;
+        alignas(64) std::atomic<uint64_t> head;     // next slot to pop
+        alignas(64) std::atomic<uint64_t> tail;     // next slot to push
+    };
+
+    Shm_Ring(const std::string& name, int fd, void* memory, size_t bytes, bool owner);
+
+    std::string name;
+    int fd;                     // kept open for the attaching process's lock
+    void* memory;
+    size_t bytes;
+    bool owner;
+    Header* header;
+    Service_Message* slots;
+    uint64_t cached_head = 0;   // producer's view of head
+    uint64_t cached_tail = 0;   // consumer's view of tail
+};
+
+#endif // SHM_RING_HPP
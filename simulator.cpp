@@ -0,0 +1,653 @@
+#include "simulator.hpp"
+#include "spsc_queue.hpp"
+#include <limits>
+#include <numeric>
+#include <cmath>
+#include <thread>
+
+Scheduler_Sim::Scheduler_Sim(const std::vector<Event>& arrivals, int scheduler_type, size_t num_servers,
+                             bool partial_servers, int r_depth, size_t full_realloc_count,
+                             double job_size_lambda, const SimulationOptions& options)
+    : arrivals(arrivals), scheduler_type(scheduler_type), full_realloc_count(full_realloc_count),
+      options(options), noise_generator(1), progress_noise(0.0, options.progress_noise),
+      completions(make_event_set(options.event_set)), realloc_counter(full_realloc_count) {
+
+    // the estimator only feeds RCGREEDY, EQUI doesn't use p
+    if(scheduler_type == E) this->options.estimate_p = false;
+
+    if(scheduler_type == E) {
+        equi = std::make_unique<EQUI>(num_servers, partial_servers);
+    } else {
+        rcgreedy = std::make_unique<RCGREEDY>(num_servers, r_depth, 1.0 / job_size_lambda, partial_servers);
+        if(options.realloc_drift_threshold > 0) {
+            rcgreedy->set_adaptive_realloc(options.realloc_drift_threshold, options.realloc_max_events);
+        }
+        if(options.fanout != 2) rcgreedy->set_fanout(options.fanout);
+        if(options.bin_rebalance_interval) {
+            rcgreedy->set_adaptive_bins(options.bin_rebalance_interval, options.bin_window);
+        }
+        if(options.auto_depth_interval) {
+            rcgreedy->set_auto_depth(options.auto_depth_interval, options.depth_evaluation_weight);
+        }
+        if(!partial_servers) rcgreedy->set_admission(options.admission);
+    }
+
+    if(options.assign_servers && options.capacity_amplitude > 0) {
+        std::cerr << "Error, concrete server assignment doesn't support capacity changes, servers won't be assigned" << std::endl;
+        this->options.assign_servers = false;
+    } else if(options.assign_servers && !partial_servers) {
+        assigner = std::make_unique<Server_Assigner>(num_servers);
+    }
+}
+
+long double Scheduler_Sim::next_completion() {
+    // Skip outdated events, only a group's current next completion is live
+    while(!completions->empty()) {
+        const Event& event = completions->top();
+        if(live(event)) return event.event_time;
+        completions->pop();
+    }
+    return std::numeric_limits<long double>::infinity();
+}
+
+bool Scheduler_Sim::live(const Event& event) const {
+    auto it = job_states.find(event.job.job_id);
+    if(it == job_states.end() || it->second.group == NO_GROUP) return false;
+    return groups[it->second.group].event == event.sequence;
+}
+
+void Scheduler_Sim::arrive(size_t arrival) {
+    const Event& event = arrivals[arrival];
+    long double current_time = event.event_time;
+
+    JobState state;
+    state.arrival = arrival;
+    state.remaining_size = event.job.size;
+    state.current_speedup = 0.0; // Will be updated once the job has servers, queued jobs make no progress
+    state.last_update_time = current_time;
+    state.expected_completion = 0.0; // Will be set soon
+    state.p_estimate = options.estimate_p ? options.p_prior : event.job.p;
+    job_states[event.job.job_id] = state;
+    auto start = std::chrono::high_resolution_clock::now();
+
+    if(scheduler_type == E) {
+        equi->insert_job(event.job.job_id);
+    } else {
+        RCGREEDY::RCGREEDY_Job job;
+        job.id = event.job.job_id;
+        job.p = state.p_estimate;
+
+        maybe_full_realloc(current_time);
+        rcgreedy->add_job(job, true);
+        realloc_counter--;
+        total_effective_depth += rcgreedy->get_effective_depth();
+    }
+    arrival_count += 1;
+
+    // Process allocation changes and update all affected jobs
+    process_allocation_changes(current_time);
+    apply_p_updates(current_time);
+    reschedule_groups();
+
+    record_event_time(start);
+}
+
+void Scheduler_Sim::complete() {
+    next_completion();
+    Event event = completions->top();
+    completions->pop();
+    long double current_time = event.event_time;
+    size_t job_id = event.job.job_id;
+
+    // Record processing time
+    const JobState& finished = job_states[job_id];
+    Completion_Record record{scheduler_index, static_cast<double>(current_time - arrivals[finished.arrival].event_time),
+                             std::abs(finished.p_estimate - arrivals[finished.arrival].job.p), finished.observations};
+    if(completion_queue) completion_queue->push_wait(record);
+    else metrics.add(record);
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    if(scheduler_type == E) {
+        equi->delete_job(job_id);
+    } else {
+        RCGREEDY::RCGREEDY_Job job;
+        job.id = job_id;
+        job.p = event.job.p;
+
+        maybe_full_realloc(current_time);
+        rcgreedy->delete_job(job, true);
+        realloc_counter--;
+    }
+
+    // finished jobs free their servers before the changes hand them out
+    if(assigner) assigner->remove_job(job_id);
+
+    // Process allocation changes and update affected jobs
+    process_allocation_changes(current_time);
+
+    set_group(job_id, job_states[job_id], NO_GROUP);
+    job_states.erase(job_id);
+    apply_p_updates(current_time);
+    reschedule_groups();
+
+    record_event_time(start);
+}
+
+SimulationResults Scheduler_Sim::results() const {
+    return results(metrics);
+}
+
+SimulationResults Scheduler_Sim::results(const Completion_Metrics& metrics) const {
+    SimulationResults results{0.0, total_real_time, max_event_time};
+    metrics.fill(results, options);
+    results.server_moves = assigner ? assigner->transfer_count() : 0;
+    if(arrival_count) results.effective_depth = static_cast<long double>(total_effective_depth) / arrival_count;
+    return results;
+}
+
+void Scheduler_Sim::stream_completions(Spsc_Queue<Completion_Record>* queue, size_t scheduler) {
+    completion_queue = queue;
+    scheduler_index = scheduler;
+}
+
+void Completion_Metrics::add(const Completion_Record& record) {
+    processing_times.push_back(record.processing_time);
+    total_p_error += record.p_error;
+    total_observations += record.observations;
+}
+
+void Completion_Metrics::fill(SimulationResults& results, const SimulationOptions& options) const {
+    size_t warmup = options.warmup_mser ? mser_truncation(processing_times) :
+                    std::min(options.warmup_jobs, processing_times.size());
+    std::vector<double> steady_state(processing_times.begin() + warmup, processing_times.end());
+
+    results.avg_processing_time = steady_state.empty() ? 0.0 :
+        std::accumulate(steady_state.begin(), steady_state.end(), 0.0) / steady_state.size();
+    results.warmup_jobs = warmup;
+    results.completed_jobs = steady_state.size();
+    if(!processing_times.empty()) {
+        results.p_error = total_p_error / processing_times.size();
+        results.p_observations = static_cast<long double>(total_observations) / processing_times.size();
+    }
+    if(options.batch_count >= 2) results.ci_half_width = batch_means_half_width(steady_state, options.batch_count);
+}
+
+size_t Scheduler_Sim::group_of(size_t job_id) {
+    if(scheduler_type == E) return 0;
+    RCGREEDY::RCGREEDY_Job job;
+    job.id = job_id;
+    return rcgreedy->get_job_leaf(job);
+}
+
+void Scheduler_Sim::mark_dirty(size_t group) {
+    if(!groups[group].dirty) {
+        groups[group].dirty = true;
+        dirty_groups.push_back(group);
+    }
+}
+
+void Scheduler_Sim::set_group(size_t job_id, JobState& state, size_t group) {
+    if(group != NO_GROUP && group >= groups.size()) groups.resize(group + 1);
+    if(state.group != NO_GROUP) {
+        if(state.group == group) return;
+        auto& members = groups[state.group].members;
+        members[state.group_slot] = members.back();
+        job_states[members.back()].group_slot = state.group_slot;
+        members.pop_back();
+        mark_dirty(state.group);
+    }
+    if(group != NO_GROUP) {
+        state.group_slot = groups[group].members.size();
+        groups[group].members.push_back(job_id);
+        mark_dirty(group);
+    }
+    state.group = group;
+}
+
+void Scheduler_Sim::update_job_processing(size_t job_id, long double update_time, double servers) {
+    auto& state = job_states[job_id];
+
+    // Calculate processed work since last update
+    double elapsed = update_time - state.last_update_time;
+    if(options.estimate_p && elapsed > 0 && state.servers > 0) observe_progress(job_id, state);
+    state.remaining_size -= state.current_speedup * elapsed;
+    state.last_update_time = update_time;
+    state.servers = servers;
+
+    // Get new speedup factor
+    double p = arrivals[state.arrival].job.p;
+    double new_speedup;
+    if(scheduler_type == E) {
+        new_speedup = equi->speedup_factor(p, servers);
+    } else {
+        new_speedup = rcgreedy->speedup_factor(p, servers);
+    }
+
+    if(new_speedup < 1e-6) new_speedup = 1e-6; // Prevent division by zero
+
+    // Update state, the group is rescheduled once all changes are in
+    state.current_speedup = new_speedup;
+    double new_processing = state.remaining_size / new_speedup;
+    state.expected_completion = update_time + new_processing;
+
+    set_group(job_id, state, group_of(job_id));
+    mark_dirty(state.group);
+}
+
+void Scheduler_Sim::observe_progress(size_t job_id, JobState& state) {
+    double rate = state.current_speedup;
+    if(options.progress_noise > 0) rate *= 1.0 + progress_noise(noise_generator);
+    if(rate < 1e-6) rate = 1e-6;
+
+    double x = 1.0 - 1.0 / state.servers;
+    double y = 1.0 - 1.0 / rate;
+    state.sum_xy += x * y;
+    state.sum_xx += x * x;
+    state.observations += 1;
+
+    double estimate = std::clamp((options.p_prior_weight * options.p_prior + state.sum_xy) 
+                                 / (options.p_prior_weight + state.sum_xx), 0.0, 1.0);
+    if(std::abs(estimate - state.p_estimate) > 1e-3) {
+        pending_p_updates.push_back(job_id);
+        state.p_estimate = estimate;
+    }
+}
+
+void Scheduler_Sim::apply_p_updates(long double current_time) {
+    // updates can change allocations, whose measurements cover no time and so add no more updates
+    for(size_t i = 0; i < pending_p_updates.size(); i++) {
+        auto it = job_states.find(pending_p_updates[i]);
+        if(it == job_states.end()) continue;
+
+        RCGREEDY::RCGREEDY_Job job;
+        job.id = it->first;
+        rcgreedy->update_job_p(job, it->second.p_estimate, true);
+        process_allocation_changes(current_time);
+    }
+    pending_p_updates.clear();
+}
+
+void Scheduler_Sim::reschedule_groups() {
+    for(size_t group : dirty_groups) {
+        auto& group_state = groups[group];
+        group_state.dirty = false;
+
+        // the event of an emptied group names a job that left, so it is stale
+        if(group_state.members.empty()) {
+            group_state.event = 0;
+            continue;
+        }
+
+        size_t next_job = group_state.members[0];
+        long double next_completion = job_states[next_job].expected_completion;
+        for(size_t job_id : group_state.members) {
+            const auto& state = job_states[job_id];
+            if(state.expected_completion < next_completion) {
+                next_job = job_id;
+                next_completion = state.expected_completion;
+            }
+        }
+
+        // an unchanged next completion keeps its event, only a popped one removes it and that
+        // job then leaves the group
+        if(group_state.event && group_state.next_job == next_job && group_state.next_completion == next_completion) {
+            continue;
+        }
+        group_state.next_job = next_job;
+        group_state.next_completion = next_completion;
+        group_state.event = ++pushed_events;
+
+        Event new_event;
+        new_event.event_type = COMPLETION;
+        new_event.event_time = group_state.next_completion;
+        new_event.job = arrivals[job_states[group_state.next_job].arrival].job;
+        new_event.sequence = group_state.event;
+        completions->push(new_event);
+    }
+    dirty_groups.clear();
+}
+
+size_t Scheduler_Sim::live_completion_events() {
+    std::vector<Event> events;
+    size_t count = 0;
+    while(!completions->empty()) {
+        const Event& event = completions->top();
+        count += live(event);
+        events.push_back(event);
+        completions->pop();
+    }
+    for(const Event& event : events) completions->push(event);
+    return count;
+}
+
+void Scheduler_Sim::resize(size_t servers, long double time) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    if(scheduler_type == E) {
+        equi->set_server_count(servers);
+    } else {
+        rcgreedy->set_server_count(servers);
+    }
+
+    process_allocation_changes(time);
+    apply_p_updates(time);
+    reschedule_groups();
+
+    record_event_time(start);
+}
+
+JobState Scheduler_Sim::evict(size_t job_id, long double time) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    JobState& state = job_states.at(job_id);
+    double elapsed = time - state.last_update_time;
+    if(options.estimate_p && elapsed > 0 && state.servers > 0) observe_progress(job_id, state);
+    state.remaining_size -= state.current_speedup * elapsed;
+    state.last_update_time = time;
+    JobState moved = state;
+
+    if(scheduler_type == E) {
+        equi->delete_job(job_id);
+    } else {
+        RCGREEDY::RCGREEDY_Job job;
+        job.id = job_id;
+        job.p = state.p_estimate;
+
+        maybe_full_realloc(time);
+        rcgreedy->delete_job(job, true);
+        realloc_counter--;
+    }
+    if(assigner) assigner->remove_job(job_id);
+
+    process_allocation_changes(time);
+
+    set_group(job_id, job_states[job_id], NO_GROUP);
+    job_states.erase(job_id);
+    apply_p_updates(time);
+    reschedule_groups();
+
+    record_event_time(start);
+
+    moved.current_speedup = 0.0;
+    moved.servers = 0.0;
+    moved.group = NO_GROUP;
+    return moved;
+}
+
+void Scheduler_Sim::admit(size_t job_id, JobState state, long double time) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // like an arrival, the job makes no progress until it has servers here
+    state.current_speedup = 0.0;
+    state.servers = 0.0;
+    state.last_update_time = time;
+    state.expected_completion = 0.0;
+    state.group = NO_GROUP;
+    job_states[job_id] = state;
+
+    if(scheduler_type == E) {
+        equi->insert_job(job_id);
+    } else {
+        RCGREEDY::RCGREEDY_Job job;
+        job.id = job_id;
+        job.p = state.p_estimate;
+
+        maybe_full_realloc(time);
+        rcgreedy->add_job(job, true);
+        realloc_counter--;
+    }
+
+    process_allocation_changes(time);
+    apply_p_updates(time);
+    reschedule_groups();
+
+    record_event_time(start);
+}
+
+void Scheduler_Sim::process_allocation_changes(long double current_time) {
+    if(scheduler_type == E) {
+        // EQUI affects all jobs
+        std::vector<std::pair<size_t, double>> output;
+        equi->get_all_allocations(output);
+        assign_servers(output);
+        for(auto& [job_id, servers] : output) {
+            update_job_processing(job_id, current_time, servers);
+        }
+    } else {
+        // RCGREEDY only affects changed jobs
+        const auto& changes = rcgreedy->get_server_changes();
+        assign_servers(changes);
+        for(auto& [job_id, servers] : changes) {
+            if(job_states.count(job_id)) {
+                update_job_processing(job_id, current_time, servers);
+            }
+        }
+    }
+}
+
+void Scheduler_Sim::assign_servers(const std::vector<std::pair<size_t, double>>& changes) {
+    if(!assigner) return;
+
+    // the extra work is added before the job's progress is brought up to date, which is
+    // the same since progress only subtracts the work done so far
+    for(const auto& move : assigner->apply(changes)) {
+        auto it = job_states.find(move.to);
+        if(move.to != Server_Assigner::NO_JOB && it != job_states.end()) {
+            it->second.remaining_size += options.migration_cost;
+        }
+    }
+}
+
+void Scheduler_Sim::maybe_full_realloc(long double current_time) {
+    bool realloced = false;
+    if(options.realloc_step_budget > 0) {
+        realloced = rcgreedy->realloc_step(options.realloc_step_budget);
+    } else if(options.realloc_drift_threshold > 0) {
+        realloced = rcgreedy->adaptive_realloc();
+    } else if(realloc_counter == 0) {
+        rcgreedy->full_realloc();
+        realloc_counter = full_realloc_count;
+        realloced = true;
+    }
+    if(realloced) process_allocation_changes(current_time);
+}
+
+void Scheduler_Sim::record_event_time(std::chrono::high_resolution_clock::time_point start) {
+    auto end = std::chrono::high_resolution_clock::now();
+    double event_time = std::chrono::duration<double>(end - start).count();
+    total_real_time += event_time;
+    max_event_time = std::max(max_event_time, event_time);
+}
+
+
+double student_t_975(size_t df) {
+    static const double table[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                   2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                   2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    if(df == 0) return 0.0;
+    if(df <= 30) return table[df - 1];
+    if(df <= 60) return 2.000;
+    if(df <= 120) return 1.980;
+    return 1.960;
+}
+
+long double ci_half_width(const std::vector<long double>& samples) {
+    size_t n = samples.size();
+    if(n < 2) return 0.0;
+    long double mean = std::accumulate(samples.begin(), samples.end(), 0.0L) / n;
+    long double square_sum = 0.0;
+    for(long double sample : samples) square_sum += (sample - mean) * (sample - mean);
+    return student_t_975(n - 1) * std::sqrt(square_sum / (n - 1) / n);
+}
+
+size_t mser_truncation(const std::vector<double>& samples) {
+    const size_t batch_size = 5;
+    size_t batches = samples.size() / batch_size;
+    if(batches < 2) return 0;
+
+    std::vector<long double> means(batches, 0.0);
+    for(size_t i = 0; i < batches * batch_size; i++) means[i / batch_size] += samples[i];
+    for(long double& mean : means) mean /= batch_size;
+
+    // suffix sums give the mean and spread of every remaining run in one pass
+    long double sum = 0.0, square_sum = 0.0;
+    size_t best = 0;
+    long double best_value = std::numeric_limits<long double>::infinity();
+    for(size_t d = batches; d-- > 0;) {
+        sum += means[d];
+        square_sum += means[d] * means[d];
+        if(d > batches / 2) continue;
+
+        long double remaining = batches - d;
+        long double spread = square_sum - sum * sum / remaining;
+        long double value = spread / (remaining * remaining);
+        if(value <= best_value) {
+            best_value = value;
+            best = d;
+        }
+    }
+    return best * batch_size;
+}
+
+long double batch_means_half_width(const std::vector<double>& samples, size_t batch_count) {
+    if(batch_count < 2 || samples.size() < batch_count) return 0.0;
+    size_t batch_size = samples.size() / batch_count;
+
+    std::vector<long double> means(batch_count, 0.0);
+    for(size_t i = 0; i < batch_count * batch_size; i++) means[i / batch_size] += samples[i];
+    for(long double& mean : means) mean /= batch_size;
+    return ci_half_width(means);
+}
+
+
+std::vector<SimulationResults> lockstep_runner(
+    const boost::heap::priority_queue<Event, boost::heap::compare<Compare_Event>>& events,
+    const std::vector<int>& scheduler_types,
+    size_t num_servers,
+    bool partial_servers,
+    size_t full_realloc_count,
+    double job_size_lambda,
+    const SimulationOptions& options
+) {
+    // decode the arrival stream once, every scheduler reads it by index
+    auto event_queue = events;
+    std::vector<Event> arrivals;
+    arrivals.reserve(event_queue.size());
+    while(!event_queue.empty()) {
+        arrivals.push_back(event_queue.top());
+        event_queue.pop();
+    }
+
+    std::vector<std::unique_ptr<Scheduler_Sim>> sims;
+    for(int flag : scheduler_types) {
+        int depth = flag == E ? 0 : __builtin_ctz(flag);
+        sims.push_back(std::make_unique<Scheduler_Sim>(arrivals, flag, num_servers, partial_servers,
+                                                       depth, full_realloc_count, job_size_lambda, options));
+    }
+
+    std::vector<Event> capacity_changes;
+    if(options.capacity_amplitude > 0 && !arrivals.empty()) {
+        capacity_changes = generate_capacity_events(num_servers, options.capacity_amplitude, options.capacity_period,
+                                                    arrivals.back().event_time, options.capacity_steps);
+    }
+
+    // every scheduler finishes the jobs due before an arrival or capacity change, then all of them
+    // see it. Capacity changes at the same time as an arrival go first
+    size_t next_change = 0;
+    for(size_t i = 0; i < arrivals.size(); i++) {
+        while(next_change < capacity_changes.size() && capacity_changes[next_change].event_time <= arrivals[i].event_time) {
+            const Event& change = capacity_changes[next_change++];
+            for(auto& sim : sims) {
+                while(sim->next_completion() < change.event_time) sim->complete();
+                sim->resize(change.servers, change.event_time);
+            }
+        }
+        for(auto& sim : sims) {
+            while(sim->next_completion() < arrivals[i].event_time) sim->complete();
+            sim->arrive(i);
+        }
+    }
+
+    std::vector<SimulationResults> results;
+    for(auto& sim : sims) {
+        while(sim->next_completion() != std::numeric_limits<long double>::infinity()) sim->complete();
+        results.push_back(sim->results());
+    }
+
+    return results;
+}
+
+
+std::vector<SimulationResults> pipelined_runner(
+    size_t num_events,
+    double arrival_lambda,
+    double job_size_lambda,
+    unsigned seed,
+    double p_min,
+    double p_max,
+    const std::vector<int>& scheduler_types,
+    size_t num_servers,
+    bool partial_servers,
+    size_t full_realloc_count,
+    const SimulationOptions& options
+) {
+    if(options.capacity_amplitude > 0) {
+        std::cerr << "Error, pipelined runs don't support capacity changes, the server count stays fixed" << std::endl;
+    }
+    auto wall_start = std::chrono::high_resolution_clock::now();
+
+    Spsc_Queue<Event> arrival_queue(options.pipeline_capacity);
+    Spsc_Queue<Completion_Record> completion_queue(options.pipeline_capacity);
+    const size_t scheduler_count = scheduler_types.size();
+
+    std::thread generator([&]() {
+        Arrival_Stream stream(arrival_lambda, job_size_lambda, seed, p_min, p_max);
+        for(size_t i = 0; i < num_events; i++) arrival_queue.push_wait(stream.next());
+    });
+
+    // a record for scheduler_count marks the end of the run
+    std::vector<Completion_Metrics> metrics(scheduler_count);
+    std::thread accumulator([&]() {
+        Completion_Record record;
+        for(completion_queue.pop_wait(record); record.scheduler < scheduler_count; completion_queue.pop_wait(record)) {
+            metrics[record.scheduler].add(record);
+        }
+    });
+
+    // the scheduling loop of lockstep_runner, reading arrivals as they are generated
+    std::vector<Event> arrivals;
+    arrivals.reserve(num_events);
+    std::vector<std::unique_ptr<Scheduler_Sim>> sims;
+    for(size_t k = 0; k < scheduler_count; k++) {
+        int flag = scheduler_types[k];
+        int depth = flag == E ? 0 : __builtin_ctz(flag);
+        sims.push_back(std::make_unique<Scheduler_Sim>(arrivals, flag, num_servers, partial_servers,
+                                                       depth, full_realloc_count, job_size_lambda, options));
+        sims.back()->stream_completions(&completion_queue, k);
+    }
+
+    for(size_t i = 0; i < num_events; i++) {
+        arrivals.emplace_back();
+        arrival_queue.pop_wait(arrivals.back());
+        for(auto& sim : sims) {
+            while(sim->next_completion() < arrivals[i].event_time) sim->complete();
+            sim->arrive(i);
+        }
+    }
+    for(auto& sim : sims) {
+        while(sim->next_completion() != std::numeric_limits<long double>::infinity()) sim->complete();
+    }
+    completion_queue.push_wait(Completion_Record{scheduler_count, 0.0, 0.0, 0});
+
+    generator.join();
+    accumulator.join();
+    double wall_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - wall_start).count();
+
+    std::vector<SimulationResults> results;
+    for(size_t k = 0; k < scheduler_count; k++) {
+        results.push_back(sims[k]->results(metrics[k]));
+        results.back().wall_time = wall_time;
+    }
+    return results;
+}
@@ -0,0 +1,374 @@
+#ifndef SIMULATOR_HPP
+#define SIMULATOR_HPP
+
+#include "rcgreedy_base.hpp"
+#include "event_generator.hpp"
+#include "event_set.hpp"
+#include "equi.hpp"
+#include "server_assigner.hpp"
+#include <chrono>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <random>
+
+struct SimulationResults {
+    long double avg_processing_time;
+    long double avg_real_time;
+    long double max_event_time;     // worst case scheduling time of a single event
+
+    // filled in by batch means in a single run, or when results are averaged over trials
+    long double ci_half_width = 0.0;        // 95% confidence interval half width of avg_processing_time
+    long double paired_ci_half_width = 0.0; // same, for the per trial difference to the first scheduler
+    size_t trials = 1;
+    size_t warmup_jobs = 0;                 // completed jobs deleted as warm-up before averaging
+    long double server_moves = 0.0;         // servers handed from one job to another, with assign_servers on
+    long double p_error = 0.0;              // mean |estimated p - p| of completed jobs, with estimate_p on
+    long double p_observations = 0.0;       // mean progress measurements per completed job
+    long double effective_depth = 0.0;      // mean RCGREEDY depth jobs were grouped at, over arrivals
+    size_t completed_jobs = 0;              // jobs averaged into avg_processing_time
+    size_t migrations = 0;                  // jobs moved between pools, with pools > 1
+    long double wall_time = 0.0;            // seconds the federated or pipelined run took
+};
+
+
+// optional simulator behaviour. The defaults reproduce the fixed full_realloc_count policy
+struct SimulationOptions {
+    double realloc_drift_threshold = 0.0;   // if > 0, RCGREEDY full reallocations are triggered by allocation drift
+    size_t realloc_max_events = 0;          // adaptive policy only: force a full realloc after this many events (0 = no limit)
+    size_t realloc_step_budget = 0;         // if > 0, every event advances an incremental realloc by this many groups
+
+    // steady state estimation, processing times are taken in completion order
+    size_t warmup_jobs = 0;                 // delete this many completed jobs before averaging
+    bool warmup_mser = false;               // pick the warm-up length with MSER-5 instead (overrides warmup_jobs)
+    size_t batch_count = 0;                 // if >= 2, report a batch means confidence interval for the run
+
+    // RCGREEDY with whole servers only: hold jobs in per leaf admission queues while their leaf is full
+    RCGREEDY::Admission admission = RCGREEDY::Admission::ALL;
+
+    // whole servers only: track which servers each job holds, and charge every server
+    // a job receives from another job or the free pool migration_cost units of extra work
+    bool assign_servers = false;
+    double migration_cost = 0.0;
+
+    // RCGREEDY only: the scheduler doesn't know p. Jobs arrive with p_prior, and every allocation
+    // change measures the job's progress rate r under its previous s servers. Since
+    // 1 - 1/r = p(1 - 1/s), p is re-estimated by least squares through the origin, with the prior
+    // counting as p_prior_weight measurements at s = infinity, and moved jobs are passed to update_job_p
+    bool estimate_p = false;
+    double p_prior = 0.5;
+    double p_prior_weight = 0.1;
+    double progress_noise = 0.0;            // relative standard deviation of each measured rate
+
+    // RCGREEDY only: children of every group, see RCGREEDY::set_fanout. The depth still sets the bins
+    size_t fanout = 2;
+
+    // RCGREEDY only: if > 0, move the bin boundaries to the quantiles of the last bin_window
+    // observed p values every bin_rebalance_interval arrivals, see RCGREEDY::set_adaptive_bins
+    size_t bin_rebalance_interval = 0;
+    size_t bin_window = 4096;
+
+    // RCGREEDY only: if > 0, retune the depth jobs are grouped at every auto_depth_interval
+    // arrivals, charging depth_evaluation_weight per candidate split, see RCGREEDY::set_auto_depth
+    size_t auto_depth_interval = 0;
+    double depth_evaluation_weight = 1e-5;
+
+    // autoscaling: if > 0, the server count follows num_servers * (1 + capacity_amplitude *
+    // sin(2 pi t / capacity_period)) in capacity_steps steps per period, see generate_capacity_events.
+    // Not supported with assign_servers
+    double capacity_amplitude = 0.0;
+    double capacity_period = 200.0;
+    size_t capacity_steps = 8;
+
+    // federation: if pools > 1, num_servers is split evenly over this many scheduler instances,
+    // each simulated on its own thread. Arrivals go to the least loaded of pool_choices random
+    // pools, and every rebalance_epoch time units jobs move out of pools holding more than
+    // rebalance_tolerance over their share of the jobs, see federated_runner.
+    // Not supported with capacity changes
+    size_t pools = 1;
+    size_t pool_choices = 2;
+    double rebalance_epoch = 10.0;
+    double rebalance_tolerance = 0.1;
+
+    // pipelining: if set, experiments generate arrivals on one thread, schedule on a second and
+    // accumulate completions on a third, connected by lock-free queues of pipeline_capacity
+    // entries, see pipelined_runner. Results match the single threaded run.
+    // Not supported with capacity changes or pools > 1
+    bool pipelined = false;
+    size_t pipeline_capacity = 4096;
+
+    // the future event set holding every scheduler's completion events, see Event_Set
+    Event_Set_Kind event_set = Event_Set_Kind::HEAP;
+};
+
+
+// 97.5% quantile of the student t distribution with df degrees of freedom
+double student_t_975(size_t df);
+
+// 95% confidence interval half width of the mean of samples, treated as independent
+long double ci_half_width(const std::vector<long double>& samples);
+
+/*
+* returns how many leading samples to delete as warm-up using MSER-5. Samples are averaged in
+* batches of 5 and the truncation point minimizing the standard error of the remaining batches
+* is chosen, only considering the first half of the run
+*/
+size_t mser_truncation(const std::vector<double>& samples);
+
+/*
+* splits samples into batch_count equal batches (the remainder at the end is dropped) and returns
+* the 95% confidence interval half width of their mean, treating the batch means as independent
+*/
+long double batch_means_half_width(const std::vector<double>& samples, size_t batch_count);
+
+
+// what a finished job adds to the results of its scheduler
+struct Completion_Record {
+    size_t scheduler;           // index of the scheduler in a pipelined run
+    double processing_time;
+    double p_error;             // |estimated p - p|
+    size_t observations;        // progress measurements of the job
+};
+
+/*
+* the completion side of a scheduler's results, kept by the scheduler itself or by the
+* metrics thread of a pipelined run
+*/
+class Completion_Metrics {
+public:
+    void add(const Completion_Record& record);
+
+    /*
+    * sets avg_processing_time, warmup_jobs, completed_jobs, p_error, p_observations and
+    * ci_half_width of results, after the warm-up deletion set in options
+    */
+    void fill(SimulationResults& results, const SimulationOptions& options) const;
+
+private:
+    std::vector<double> processing_times;   // in completion order
+    double total_p_error = 0.0;
+    size_t total_observations = 0;
+};
+
+template <typename T> class Spsc_Queue;
+
+
+const size_t NO_GROUP = static_cast<size_t>(-1);
+
+struct JobState {
+    size_t arrival;             // index of the job's arrival in the shared arrival stream
+    double remaining_size;
+    double current_speedup;
+    double servers = 0.0;       // servers the job has held since last_update_time
+    long double last_update_time;
+    long double expected_completion;
+    size_t group = NO_GROUP;    // scheduler group the job shares servers with
+    size_t group_slot = 0;      // position in the group's member list
+
+    // p estimation, see SimulationOptions::estimate_p
+    double p_estimate = 0.0;    // p as known to the scheduler
+    double sum_xy = 0.0;        // sums of (1 - 1/s)(1 - 1/r) and (1 - 1/s)^2 over measurements
+    double sum_xx = 0.0;
+    size_t observations = 0;
+};
+
+// jobs sharing servers in the simulator, which keeps one completion event per group
+struct GroupState {
+    std::vector<size_t> members;
+    size_t next_job = 0;                // member expected to finish first
+    long double next_completion = 0.0;
+    bool dirty = false;                 // needs its next completion recomputed
+    size_t event = 0;                   // sequence of the live completion event, 0 if there is none
+};
+
+// scheduler flags, RCGREEDY flags are 2^depth
+const int E = 1;
+const int R1 = 2;
+const int R2 = 4;     // r=2 (2^2)
+const int R3 = 8;     // r=3 (2^3)
+const int R4 = 16;    // r=4 (2^4)
+const int R5 = 32;    // r=5 (2^5)
+const int R6 = 64;    // r=6 (2^6)
+const int R7 = 128;   // r=7 (2^7)
+const int R8 = 256;   // r=8 (2^8)
+const int R9 = 512;
+
+
+/*
+* the simulation state of one scheduler. Arrivals are read from a stream shared by every
+* scheduler being compared, each instance only keeps its own job progress and completion
+* events, so several instances can be driven side by side over one pass of the input
+*/
+class Scheduler_Sim {
+public:
+    /*
+    * arrivals is the shared arrival stream in time order and must outlive the instance.
+    * scheduler_type is E or an RCGREEDY flag, r_depth is only used for RCGREEDY
+    */
+    Scheduler_Sim(const std::vector<Event>& arrivals, int scheduler_type, size_t num_servers,
+                  bool partial_servers, int r_depth = 0, size_t full_realloc_count = 10,
+                  double job_size_lambda = 1.0, const SimulationOptions& options = SimulationOptions());
+
+    /*
+    * returns the time of the next job completion, or infinity if no jobs are running
+    */
+    long double next_completion();
+
+    /*
+    * adds arrivals[arrival] to the scheduler, its event time must not be before the next completion
+    */
+    void arrive(size_t arrival);
+
+    /*
+    * finishes the job with the next completion, there must be one
+    */
+    void complete();
+
+    /*
+    * changes the number of servers at time, which must not be before the next completion
+    */
+    void resize(size_t servers, long double time);
+
+    /*
+    * removes a running job at time, which must not be before the next completion, and returns
+    * its state with the progress brought up to time, for admit on another instance
+    */
+    JobState evict(size_t job_id, long double time);
+
+    /*
+    * adds a job evicted from another instance over the same arrival stream at time, which must
+    * not be before the next completion. Its remaining size and p estimate carry over
+    */
+    void admit(size_t job_id, JobState state, long double time);
+
+    // the jobs currently in the system
+    const std::unordered_map<size_t, JobState>& jobs() const { return job_states; }
+
+    /*
+    * returns the number of completion events that are still live, each the next completion of
+    * its group. Pops every event and pushes it back, so it is meant for tests
+    */
+    size_t live_completion_events();
+
+    /*
+    * returns the results for every job completed so far, after the warm-up deletion
+    * set in the options and with a batch means interval if batches were requested
+    */
+    SimulationResults results() const;
+
+    // the same, with the completion side taken from metrics, for completions streamed out
+    SimulationResults results(const Completion_Metrics& metrics) const;
+
+    /*
+    * sends every later completion to queue, tagged with scheduler, instead of keeping it.
+    * The queue must outlive the instance
+    */
+    void stream_completions(Spsc_Queue<Completion_Record>* queue, size_t scheduler);
+
+private:
+    const std::vector<Event>& arrivals;
+    int scheduler_type;
+    size_t full_realloc_count;
+    SimulationOptions options;
+
+    std::unique_ptr<RCGREEDY> rcgreedy;
+    std::unique_ptr<EQUI> equi;
+    std::unique_ptr<Server_Assigner> assigner;  // only with assign_servers
+
+    std::mt19937 noise_generator;
+    std::normal_distribution<double> progress_noise;
+    std::vector<size_t> pending_p_updates;      // jobs whose estimate moved since the scheduler last saw it
+    size_t total_effective_depth = 0;           // summed over arrivals
+    size_t arrival_count = 0;
+
+    std::unique_ptr<Event_Set> completions;
+    std::unordered_map<size_t, JobState> job_states;
+    Completion_Metrics metrics;
+    Spsc_Queue<Completion_Record>* completion_queue = nullptr;
+    size_t scheduler_index = 0;
+    double total_real_time = 0.0;
+    double max_event_time = 0.0;
+    size_t realloc_counter;
+
+    // jobs are grouped the way the scheduler shares servers (RCGREEDY leaves, the whole
+    // system for EQUI). A group is only rescheduled as a whole, so it keeps one completion
+    // event for whichever of its jobs finishes first instead of one event per job. Members
+    // progress at rates set by their own p, so rescheduling a changed group still rescans all
+    // of its jobs: a step costs O(jobs in the changed groups) plus one O(log groups) push per
+    // changed group, instead of a push per changed job. The scheduler lists every job of a
+    // changed leaf anyway, so the rescan is of the same order as applying its changes
+    std::vector<GroupState> groups;
+    std::vector<size_t> dirty_groups;
+    size_t pushed_events = 0;                   // completion events pushed so far, the last one's sequence
+
+    // true if event is the live completion event of its job's group
+    bool live(const Event& event) const;
+
+    size_t group_of(size_t job_id);
+    void mark_dirty(size_t group);
+
+    // moves a job into the member list of group, fixing the slot of the job swapped into its place
+    void set_group(size_t job_id, JobState& state, size_t group);
+
+    void update_job_processing(size_t job_id, long double update_time, double servers);
+
+    // adds the job's rate since its last update, under state.servers, as a measurement of its p
+    void observe_progress(size_t job_id, JobState& state);
+
+    // passes refined estimates to the scheduler and applies the changes this causes
+    void apply_p_updates(long double current_time);
+
+    // finds the next job to finish in every changed group, O(members), and adds its completion
+    // event unless the live one still holds. Only the group's latest event is live, so an event
+    // left behind by a job that moved away and back can't count twice
+    void reschedule_groups();
+
+    void process_allocation_changes(long double current_time);
+
+    // moves concrete servers to match changes and charges the migration cost for them
+    void assign_servers(const std::vector<std::pair<size_t, double>>& changes);
+
+    // runs a full reallocation when the active policy calls for one, and applies its changes
+    void maybe_full_realloc(long double current_time);
+
+    void record_event_time(std::chrono::high_resolution_clock::time_point start);
+};
+
+
+/*
+* runs every scheduler in scheduler_types (E or an RCGREEDY flag, whose depth is log2 of the flag)
+* in lockstep over one copy of events, returning their results in the same order
+*/
+std::vector<SimulationResults> lockstep_runner(
+    const boost::heap::priority_queue<Event, boost::heap::compare<Compare_Event>>& events,
+    const std::vector<int>& scheduler_types,
+    size_t num_servers,
+    bool partial_servers,
+    size_t full_realloc_count = 10,
+    double job_size_lambda = 1.0,
+    const SimulationOptions& options = SimulationOptions()
+);
+
+/*
+* lockstep_runner with the work split over three threads: one generates num_events arrivals
+* with an Arrival_Stream (arguments as generate_events), one only runs the schedulers and one
+* accumulates their completions, connected by lock-free queues of options.pipeline_capacity
+* entries. Returns the same results as lockstep_runner over generate_events with a non zero seed,
+* with wall_time set. Capacity changes are not supported and are ignored
+*/
+std::vector<SimulationResults> pipelined_runner(
+    size_t num_events,
+    double arrival_lambda,
+    double job_size_lambda,
+    unsigned seed,
+    double p_min,
+    double p_max,
+    const std::vector<int>& scheduler_types,
+    size_t num_servers,
+    bool partial_servers,
+    size_t full_realloc_count = 10,
+    const SimulationOptions& options = SimulationOptions()
+);
+
+
+#endif // SIMULATOR_HPP
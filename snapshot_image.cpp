@@ -0,0 +1,37 @@
+#include "snapshot_image.hpp"
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool write_image_file(const std::string &path, const std::vector<char> &image) {
+    // written next to the target and renamed over it, so a crash never leaves half an image
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.write(image.data(), image.size())) return false;
+    }
+    return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+Mapped_File::Mapped_File(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        void *mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            memory = static_cast<const char *>(mapped);
+            bytes = info.st_size;
+        }
+    }
+    close(fd);
+}
+
+Mapped_File::~Mapped_File() {
+    if (memory) munmap(const_cast<char *>(memory), bytes);
+}
+
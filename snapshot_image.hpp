@@ -0,0 +1,120 @@
+#ifndef SNAPSHOT_IMAGE_HPP
+#define SNAPSHOT_IMAGE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/*
+* flat binary scheduler images. An image is a header followed by the raw bytes of plain
+* values and of whole vectors (a count, then the elements), so restoring copies arrays back
+* in bulk instead of rebuilding them element by element. Images hold the in memory layout,
+* so they are only read back by the same build on the same architecture, which the header's
+* layout word checks
+*/
+const uint64_t IMAGE_MAGIC = 0x31504e5347435200ull;   // "\0RCGSNP1"
+
+enum Image_Kind : uint32_t { RCGREEDY_IMAGE = 1, EQUI_IMAGE = 2 };
+
+class Image_Writer {
+public:
+    explicit Image_Writer(std::vector<char> &image) : image(image) {}
+
+    template <typename T> void put(const T &value) {
+        static_assert(std::is_trivially_copyable<T>::value, "images hold plain values");
+        const char *bytes = reinterpret_cast<const char *>(&value);
+        image.insert(image.end(), bytes, bytes + sizeof(T));
+    }
+
+    template <typename T> void put_vector(const std::vector<T> &values) {
+        static_assert(std::is_trivially_copyable<T>::value, "images hold plain values");
+        put<uint64_t>(values.size());
+        const char *bytes = reinterpret_cast<const char *>(values.data());
+        image.insert(image.end(), bytes, bytes + values.size() * sizeof(T));
+    }
+
+    // kind and a word describing the layout of the structures that follow
+    void header(Image_Kind kind, uint64_t layout) {
+        put(IMAGE_MAGIC);
+        put<uint32_t>(kind);
+        put(layout);
+    }
+
+private:
+    std::vector<char> &image;
+};
+
+class Image_Reader {
+public:
+    Image_Reader(const char *data, size_t size) : cursor(data), end(data + size) {}
+
+    template <typename T> bool get(T &value) {
+        static_assert(std::is_trivially_copyable<T>::value, "images hold plain values");
+        if (static_cast<size_t>(end - cursor) < sizeof(T)) return ok = false;
+        std::memcpy(&value, cursor, sizeof(T));
+        cursor += sizeof(T);
+        return ok;
+    }
+
+    // a bool must be stored as 0 or 1
+    bool get(bool &value) {
+        uint8_t byte = 0;
+        if (!get(byte) || byte > 1) return ok = false;
+        value = byte;
+        return ok;
+    }
+
+    template <typename T> bool get_vector(std::vector<T> &values) {
+        uint64_t count = 0;
+        if (!get(count) || count > static_cast<size_t>(end - cursor) / sizeof(T)) return ok = false;
+        values.resize(count);
+        if (count) std::memcpy(static_cast<void *>(values.data()), cursor, count * sizeof(T));
+        cursor += count * sizeof(T);
+        return ok;
+    }
+
+    // true if the image starts with a header of kind and layout
+    bool header(Image_Kind kind, uint64_t layout) {
+        uint64_t magic = 0, image_layout = 0;
+        uint32_t image_kind = 0;
+        get(magic);
+        get(image_kind);
+        get(image_layout);
+        return ok = ok && magic == IMAGE_MAGIC && image_kind == kind && image_layout == layout;
+    }
+
+    // false once any read ran past the end of the image
+    bool good() const { return ok; }
+
+private:
+    const char *cursor;
+    const char *end;
+    bool ok = true;
+};
+
+// writes image to path, returns false on failure
+bool write_image_file(const std::string &path, const std::vector<char> &image);
+
+/*
+* a file mapped read only, for restoring straight from the page cache. data() is null if
+* the file couldn't be opened or mapped
+*/
+class Mapped_File {
+public:
+    explicit Mapped_File(const std::string &path);
+    ~Mapped_File();
+    Mapped_File(const Mapped_File &) = delete;
+    Mapped_File &operator=(const Mapped_File &) = delete;
+
+    const char *data() const { return memory; }
+    size_t size() const { return bytes; }
+
+private:
+    const char *memory = nullptr;
+    size_t bytes = 0;
+};
+
+#endif // SNAPSHOT_IMAGE_HPP
@@ -0,0 +1,101 @@
+#include "speedup_kernels.hpp"
+
+// the kernels must round exactly like the scalar code, so a multiply followed by an add 
+// must never be fused (avx512f implies fma, and gcc would otherwise contract them)
+#pragma GCC optimize("fp-contract=off")
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+void objective_scalar(const Objective_Params &params, size_t first, size_t count, double *out) {
+    for (size_t i = 0; i < count; ++i) {
+        double a1 = static_cast<double>(first + i);
+        double a2 = params.total_servers - a1;
+        double speedup_1 = 1.0 / ((params.p1 / (a1 / params.jobs_1)) + 1 - params.p1);
+        double speedup_2 = 1.0 / ((params.p2 / (a2 / params.jobs_2)) + 1 - params.p2);
+        out[i] = params.constant * (params.jobs_1 * speedup_1 + params.jobs_2 * speedup_2);
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("avx2")))
+void objective_avx2(const Objective_Params &params, size_t first, size_t count, double *out) {
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d step = _mm256_set1_pd(4.0);
+    const __m256d constant = _mm256_set1_pd(params.constant);
+    const __m256d p1 = _mm256_set1_pd(params.p1);
+    const __m256d p2 = _mm256_set1_pd(params.p2);
+    const __m256d jobs_1 = _mm256_set1_pd(params.jobs_1);
+    const __m256d jobs_2 = _mm256_set1_pd(params.jobs_2);
+    const __m256d total = _mm256_set1_pd(params.total_servers);
+
+    // candidates are integers below 2^53, so stepping them in doubles is exact
+    double start = static_cast<double>(first);
+    __m256d a1 = _mm256_set_pd(start + 3, start + 2, start + 1, start);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d a2 = _mm256_sub_pd(total, a1);
+        __m256d speedup_1 = _mm256_div_pd(one, _mm256_sub_pd(_mm256_add_pd(_mm256_div_pd(p1, _mm256_div_pd(a1, jobs_1)), one), p1));
+        __m256d speedup_2 = _mm256_div_pd(one, _mm256_sub_pd(_mm256_add_pd(_mm256_div_pd(p2, _mm256_div_pd(a2, jobs_2)), one), p2));
+        __m256d value = _mm256_mul_pd(constant, _mm256_add_pd(_mm256_mul_pd(jobs_1, speedup_1), _mm256_mul_pd(jobs_2, speedup_2)));
+        _mm256_storeu_pd(out + i, value);
+        a1 = _mm256_add_pd(a1, step);
+    }
+
+    objective_scalar(params, first + i, count - i, out + i);
+}
+
+__attribute__((target("avx512f")))
+void objective_avx512(const Objective_Params &params, size_t first, size_t count, double *out) {
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d step = _mm512_set1_pd(8.0);
+    const __m512d constant = _mm512_set1_pd(params.constant);
+    const __m512d p1 = _mm512_set1_pd(params.p1);
+    const __m512d p2 = _mm512_set1_pd(params.p2);
+    const __m512d jobs_1 = _mm512_set1_pd(params.jobs_1);
+    const __m512d jobs_2 = _mm512_set1_pd(params.jobs_2);
+    const __m512d total = _mm512_set1_pd(params.total_servers);
+
+    double start = static_cast<double>(first);
+    __m512d a1 = _mm512_set_pd(start + 7, start + 6, start + 5, start + 4, start + 3, start + 2, start + 1, start);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m512d a2 = _mm512_sub_pd(total, a1);
+        __m512d speedup_1 = _mm512_div_pd(one, _mm512_sub_pd(_mm512_add_pd(_mm512_div_pd(p1, _mm512_div_pd(a1, jobs_1)), one), p1));
+        __m512d speedup_2 = _mm512_div_pd(one, _mm512_sub_pd(_mm512_add_pd(_mm512_div_pd(p2, _mm512_div_pd(a2, jobs_2)), one), p2));
+        __m512d value = _mm512_mul_pd(constant, _mm512_add_pd(_mm512_mul_pd(jobs_1, speedup_1), _mm512_mul_pd(jobs_2, speedup_2)));
+        _mm512_storeu_pd(out + i, value);
+        a1 = _mm512_add_pd(a1, step);
+    }
+
+    objective_scalar(params, first + i, count - i, out + i);
+}
+
+#endif
+
+std::vector<Objective_Kernel> supported_objective_kernels() {
+    std::vector<Objective_Kernel> kernels = {objective_scalar};
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) kernels.push_back(objective_avx2);
+    if (__builtin_cpu_supports("avx512f")) kernels.push_back(objective_avx512);
+#endif
+    return kernels;
+}
+
+Objective_Kernel select_objective_kernel() {
+    static const Objective_Kernel fastest = supported_objective_kernels().back();
+    return fastest;
+}
+
+const char *objective_kernel_name(Objective_Kernel kernel) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (kernel == objective_avx512) return "avx512";
+    if (kernel == objective_avx2) return "avx2";
+#endif
+    return "scalar";
+}
@@ -0,0 +1,46 @@
+#ifndef SPEEDUP_KERNELS_HPP
+#define SPEEDUP_KERNELS_HPP
+
+#include <cstddef>
+#include <vector>
+
+/*
+* kernels evaluating the GREEDY* objective used by RCGREEDY::optimal_server_count,
+*   constant * (jobs_1 * speedup(p1, a1 / jobs_1) + jobs_2 * speedup(p2, (total - a1) / jobs_2)),
+* for a batch of consecutive candidate a1 values. Every kernel performs the same IEEE
+* operations in the same order, so they return bit-identical values and the argmax
+* (and its tie-breaking) does not depend on which kernel ran
+*/
+
+struct Objective_Params {
+    double constant;        // maximization constant, 1/E(X)
+    double p1;
+    double jobs_1;
+    double p2;
+    double jobs_2;
+    double total_servers;
+};
+
+// number of candidates evaluated per kernel call by optimal_server_count
+const size_t OBJECTIVE_BATCH = 256;
+
+// writes the objective for candidates first..first + count - 1 into out
+using Objective_Kernel = void (*)(const Objective_Params &params, size_t first, size_t count, double *out);
+
+void objective_scalar(const Objective_Params &params, size_t first, size_t count, double *out);
+
+#if defined(__x86_64__) || defined(__i386__)
+void objective_avx2(const Objective_Params &params, size_t first, size_t count, double *out);
+void objective_avx512(const Objective_Params &params, size_t first, size_t count, double *out);
+#endif
+
+// returns every kernel the running cpu supports, slowest first
+std::vector<Objective_Kernel> supported_objective_kernels();
+
+// returns the fastest kernel the running cpu supports
+Objective_Kernel select_objective_kernel();
+
+// returns the name of a kernel ("scalar", "avx2" or "avx512")
+const char *objective_kernel_name(Objective_Kernel kernel);
+
+#endif // SPEEDUP_KERNELS_HPP
@@ -0,0 +1,74 @@
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+/*
+* single producer single consumer queue between two threads of one process, the in process
+* counterpart of Shm_Ring. The producer only writes tail and the consumer only writes head,
+* each on its own cache line, and each side caches the other's index so a push or pop only
+* reads the shared index when the queue looks full or empty
+*/
+template <typename T>
+class Spsc_Queue {
+public:
+    // room for capacity values, rounded up to a power of two
+    explicit Spsc_Queue(size_t capacity) {
+        size_t slot_count = 1;
+        while (slot_count < capacity) slot_count <<= 1;
+        slots.resize(slot_count);
+        mask = slot_count - 1;
+    }
+
+    Spsc_Queue(const Spsc_Queue&) = delete;
+    Spsc_Queue& operator=(const Spsc_Queue&) = delete;
+
+    // producer side, returns false if the queue is full
+    bool push(const T& value) {
+        uint64_t current = tail.load(std::memory_order_relaxed);
+        if (current - cached_head > mask) {
+            cached_head = head.load(std::memory_order_acquire);
+            if (current - cached_head > mask) return false;
+        }
+        slots[current & mask] = value;
+        tail.store(current + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side, returns false if the queue is empty
+    bool pop(T& value) {
+        uint64_t current = head.load(std::memory_order_relaxed);
+        if (current == cached_tail) {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (current == cached_tail) return false;
+        }
+        value = slots[current & mask];
+        head.store(current + 1, std::memory_order_release);
+        return true;
+    }
+
+    // push and pop that yield until there is room or a value
+    void push_wait(const T& value) {
+        while (!push(value)) std::this_thread::yield();
+    }
+
+    void pop_wait(T& value) {
+        while (!pop(value)) std::this_thread::yield();
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+private:
+    std::vector<T> slots;
+    uint64_t mask;
+    alignas(64) std::atomic<uint64_t> head{0};  // next slot to pop
+    uint64_t cached_tail = 0;                   // consumer's copy of tail
+    alignas(64) std::atomic<uint64_t> tail{0};  // next slot to push
+    uint64_t cached_head = 0;                   // producer's copy of head
+};
+
+#endif // SPSC_QUEUE_HPP
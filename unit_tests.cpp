@@ -1,4 +1,32 @@
 #include "unit_tests.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <numeric>
+#include <random>
+#include <set>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// counts heap allocations made by the current thread while count_allocations is set
+thread_local bool count_allocations = false;
+thread_local size_t allocation_count = 0;
+
+// kept out of line, gcc otherwise sees free called on memory from operator new once inlined
+__attribute__((noinline)) void* operator new(size_t size) {
+    if (count_allocations) allocation_count += 1;
+    if (void* ptr = std::malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+__attribute__((noinline)) void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
 
 bool double_eq(double a, double b) {
     return std::fabs(a - b) < EPS;
@@ -16,6 +44,41 @@ void print_result(const std::string& test_name, bool passed, const std::string&
     }
 }
 
+/*
+* applies random adds, deletes and p updates to rcg, keeping every job's servers from
+* get_server_changes alone. Returns true if after each one the kept servers match
+* get_server_count for every job in the scheduler
+*/
+bool changes_match_allocations(RCGREEDY& rcg, unsigned seed, size_t operations) {
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::vector<RCGREEDY::RCGREEDY_Job> live;
+    std::unordered_map<size_t, double> servers;
+    bool ok = true;
+    for (size_t id = 0, i = 0; ok && i < operations; ++i) {
+        double action = uniform(generator);
+        size_t removed = static_cast<size_t>(-1);
+        if (live.empty() || action < 0.55) {
+            live.push_back({id++, uniform(generator)});
+            rcg.add_job(live.back(), generator() % 2);
+        } else if (action < 0.8) {
+            size_t victim = generator() % live.size();
+            removed = live[victim].id;
+            rcg.delete_job(live[victim], generator() % 2);
+            live[victim] = live.back();
+            live.pop_back();
+        } else {
+            RCGREEDY::RCGREEDY_Job& job = live[generator() % live.size()];
+            rcg.update_job_p(job, uniform(generator), generator() % 2);
+        }
+
+        for (const auto& change : rcg.get_server_changes()) servers[change.first] = change.second;
+        servers.erase(removed);
+        for (auto& job : live) ok &= double_eq(servers[job.id], rcg.get_server_count(job));
+    }
+    return ok;
+}
+
 int unit_tests() {
 
     // ---- Test 1: EQUI insertion and deletion ----
@@ -164,5 +227,921 @@ int unit_tests() {
         print_result(std::to_string(allocs[1].second), ok, "1000000.0", std::to_string(allocs[1].second));
     }
 
+    // ---- Test 12: RCGREEDY adaptive reallocation ----
+    {
+        RCGREEDY rcg(10, 3, 0.5);
+        rcg.set_adaptive_realloc(0.5);
+        bool ok = !rcg.adaptive_realloc(); // nothing has drifted yet
+        RCGREEDY::RCGREEDY_Job job{1, 0.3};
+        rcg.add_job(job, false);           // first job in an empty tree is a full drift
+        ok &= double_eq(rcg.get_allocation_drift(), 1.0);
+        ok &= rcg.adaptive_realloc();
+        ok &= double_eq(rcg.get_allocation_drift(), 0.0);
+        ok &= !rcg.adaptive_realloc();
+        std::vector<std::pair<size_t, double>> allocs;
+        rcg.get_all_server_count(allocs);
+        ok &= allocs.size() == 1 && double_eq(allocs[0].second, 10.0);
+        print_result("RCGREEDY Adaptive Realloc", ok);
+    }
+
+    // ---- Test 13: RCGREEDY budgeted reallocation matches full reallocation ----
+    {
+        RCGREEDY stepped(20, 3, 0.5), full(20, 3, 0.5);
+        std::vector<RCGREEDY::RCGREEDY_Job> jobs = {{1, 0.1}, {2, 0.3}, {3, 0.55}, {4, 0.9}, {5, 0.95}};
+        for (auto& job : jobs) {
+            stepped.add_job(job, false);
+            full.add_job(job, false);
+        }
+        std::vector<std::pair<size_t, double>> before, during, a1, a2;
+        stepped.get_all_server_count(before);
+        bool ok = !stepped.realloc_step(1);    // one group per step cannot finish the tree
+        stepped.get_all_server_count(during);
+        ok &= before == during;                // previous allocation still visible
+        size_t steps = 1;
+        while (!stepped.realloc_step(1)) steps++;
+        ok &= !stepped.realloc_in_progress() && steps > 1;
+        full.full_realloc();
+        stepped.get_all_server_count(a1);
+        full.get_all_server_count(a2);
+        std::sort(a1.begin(), a1.end());
+        std::sort(a2.begin(), a2.end());
+        ok &= a1 == a2;
+
+        // servers committed below a leaf emptied during the pass must not look current to a later add
+        RCGREEDY emptied(4, 3, 1.0, true);
+        RCGREEDY::RCGREEDY_Job job_2{2, 0.979}, job_4{4, 0.29}, job_6{6, 0.995};
+        emptied.add_job(job_2, false);
+        emptied.realloc_step(3);
+        emptied.delete_job(job_2, true);
+        emptied.add_job(job_4, false);
+        emptied.realloc_step(3);
+        emptied.add_job(job_6, true);
+        std::vector<std::pair<size_t, double>> allocs;
+        emptied.get_all_server_count(allocs);
+        double total = 0.0;
+        for (auto& alloc : allocs) total += alloc.second;
+        ok &= total <= 4 + EPS;
+
+        // a local reallocation between steps isn't overwritten by the splits staged before it
+        RCGREEDY resplit(4, 2, 1.0, false), resplit_full(4, 2, 1.0, false);
+        for (auto& job : std::vector<RCGREEDY::RCGREEDY_Job>{{1, 0.1}, {2, 0.4}, {3, 0.8}}) {
+            resplit.add_job(job, false);
+            resplit_full.add_job(job, false);
+        }
+        resplit.realloc_step(4);               // stages the root and the whole low p half
+        RCGREEDY::RCGREEDY_Job job_5{5, 0.15};
+        resplit.add_job(job_5, true);          // no spare servers in its leaf, splits the tree again
+        resplit_full.add_job(job_5, false);
+        while (!resplit.realloc_step(1)) {}
+        resplit_full.full_realloc();
+        a1.clear();
+        a2.clear();
+        resplit.get_all_server_count(a1);
+        resplit_full.get_all_server_count(a2);
+        std::sort(a1.begin(), a1.end());
+        std::sort(a2.begin(), a2.end());
+        ok &= a1 == a2;
+
+        // a leaf emptied during the pass leaves its servers to the rest
+        RCGREEDY drained(6, 1, 1.0, true);
+        RCGREEDY::RCGREEDY_Job low{1, 0.2}, high{2, 0.7};
+        drained.add_job(low, false);
+        drained.add_job(high, false);
+        drained.realloc_step(2);               // stages the root and the low p leaf
+        drained.delete_job(low, false);
+        ok &= drained.realloc_step(1) && double_eq(drained.get_server_count(high), 6.0);
+
+        // as does a group split locally during the pass that loses its last job afterwards
+        RCGREEDY moved(1, 4, 1.0, true);
+        std::vector<RCGREEDY::RCGREEDY_Job> moved_jobs = {{8, 1578 / 4096.0}, {18, 1653 / 4096.0}, {39, 1307 / 4096.0},
+                                                          {41, 1114 / 4096.0}, {48, 1306 / 4096.0}};
+        moved.add_job(moved_jobs[0], true);
+        moved.add_job(moved_jobs[1], true);
+        moved.add_job(moved_jobs[2], false);
+        moved.update_job_p(moved_jobs[0], 1.0, true);
+        moved.add_job(moved_jobs[3], false);
+        moved.delete_job(moved_jobs[2], true);
+        moved.realloc_step(8);
+        moved.delete_job(moved_jobs[3], false);
+        moved.add_job(moved_jobs[4], true);     // splits the parent of job 41's old leaf again
+        moved.delete_job(moved_jobs[4], true);  // and leaves that parent without jobs
+        while (!moved.realloc_step(6)) {}
+        ok &= double_eq(moved.get_server_count(moved_jobs[0]) + moved.get_server_count(moved_jobs[1]), 1.0);
+        print_result("RCGREEDY Budgeted Realloc", ok);
+    }
+
+    // ---- Test 14: RCGREEDY steady state add/delete does not allocate ----
+    {
+        RCGREEDY rcg(100, 8, 1.0, true);
+        rcg.reserve(512);
+        std::vector<RCGREEDY::RCGREEDY_Job> jobs(512);
+        for (size_t i = 0; i < jobs.size(); ++i) jobs[i] = {i, (i * 37 % 512) / 512.0};
+
+        // one warm up round lets the history reach its peak size
+        for (size_t round = 0; round < 2; ++round) {
+            count_allocations = round == 1;
+            for (auto& job : jobs) rcg.add_job(job, true);
+            for (auto& job : jobs) rcg.delete_job(job, true);
+            count_allocations = false;
+        }
+        print_result("RCGREEDY Allocation Free Add/Delete", allocation_count == 0, "0", std::to_string(allocation_count));
+    }
+
+    // ---- Test 15: objective kernels agree with the scalar kernel ----
+    {
+        std::mt19937 generator(15);
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        std::vector<double> expected(1001), actual(1001);
+        bool ok = true;
+        for (size_t trial = 0; trial < 50; ++trial) {
+            Objective_Params params{2.0, uniform(generator), 1.0 + (trial % 7), uniform(generator), 1.0 + (trial % 5), 1000.0};
+            if (trial == 0) params.p1 = 0.0;    // 0/0 candidates must agree too
+            objective_scalar(params, 0, expected.size(), expected.data());
+            for (Objective_Kernel kernel : supported_objective_kernels()) {
+                kernel(params, 0, actual.size(), actual.data());
+                for (size_t i = 0; i < actual.size(); ++i) {
+                    ok &= actual[i] == expected[i] || (std::isnan(actual[i]) && std::isnan(expected[i]));
+                }
+            }
+        }
+
+        // the argmax, including tie-breaking, doesn't depend on the kernel
+        for (Objective_Kernel kernel : supported_objective_kernels()) {
+            RCGREEDY fast(997, 4, 1.0, false), scalar(997, 4, 1.0, false);
+            fast.set_objective_kernel(kernel);
+            scalar.set_objective_kernel(objective_scalar);
+            for (size_t i = 0; i < 40; ++i) {
+                RCGREEDY::RCGREEDY_Job job{i, uniform(generator)};
+                fast.add_job(job, true);
+                scalar.add_job(job, true);
+            }
+            fast.full_realloc();
+            scalar.full_realloc();
+            std::vector<std::pair<size_t, double>> a1, a2;
+            fast.get_all_server_count(a1);
+            scalar.get_all_server_count(a2);
+            ok &= a1 == a2;
+        }
+        print_result(std::string("Objective Kernels (fastest: ") + objective_kernel_name(select_objective_kernel()) + ")", ok);
+    }
+
+    // ---- Test 16: MSER-5 finds an initial transient, batch means covers the mean ----
+    {
+        std::mt19937 generator(16);
+        std::normal_distribution<double> noise(1.0, 0.1);
+        std::vector<double> samples;
+        for (size_t i = 0; i < 100; ++i) samples.push_back(10.0 - 0.09 * i + noise(generator));
+        for (size_t i = 0; i < 900; ++i) samples.push_back(noise(generator));
+        size_t warmup = mser_truncation(samples);
+
+        std::vector<double> steady(samples.begin() + warmup, samples.end());
+        double mean = std::accumulate(steady.begin(), steady.end(), 0.0) / steady.size();
+        long double half_width = batch_means_half_width(steady, 20);
+        bool ok = warmup >= 80 && warmup <= 150 && half_width > 0 && std::abs(mean - 1.0) < 2 * half_width;
+        print_result("MSER Warm-up And Batch Means", ok, "80-150", std::to_string(warmup));
+    }
+
+    // ---- Test 17: admission queues with whole servers ----
+    {
+        bool ok = true;
+        for (auto order : {RCGREEDY::Admission::FCFS, RCGREEDY::Admission::SMALLEST_P}) {
+            RCGREEDY scheduler(2, 0, 1.0, false);
+            scheduler.set_admission(order);
+            RCGREEDY::RCGREEDY_Job jobs[4] = {{0, 0.5}, {1, 0.5}, {2, 0.9}, {3, 0.1}};
+            for (auto& job : jobs) scheduler.add_job(job, true);
+
+            // two servers admit two jobs, the others wait with none
+            ok &= scheduler.get_waiting_count() == 2;
+            ok &= scheduler.get_server_count(jobs[2]) == 0.0 && scheduler.get_server_count(jobs[3]) == 0.0;
+
+            // a completion admits the next job in order, which takes the freed server
+            scheduler.delete_job(jobs[0], true);
+            RCGREEDY::RCGREEDY_Job& next = order == RCGREEDY::Admission::FCFS ? jobs[2] : jobs[3];
+            RCGREEDY::RCGREEDY_Job& still_waiting = order == RCGREEDY::Admission::FCFS ? jobs[3] : jobs[2];
+            ok &= scheduler.get_waiting_count() == 1;
+            ok &= scheduler.get_server_count(next) == 1.0 && scheduler.get_server_count(still_waiting) == 0.0;
+            bool reported = false;
+            for (const auto& [id, servers] : scheduler.get_server_changes()) reported |= id == next.id && servers == 1.0;
+            ok &= reported;
+
+            // waiting jobs can leave without touching the allocation
+            scheduler.delete_job(still_waiting, true);
+            ok &= scheduler.get_waiting_count() == 0 && scheduler.get_server_changes().empty();
+
+            // moving a job into a full leaf reports both the job it makes room for and its own wait
+            RCGREEDY moved(3, 1, 1.0, false);
+            moved.set_admission(order);
+            RCGREEDY::RCGREEDY_Job moving[4] = {{0, 0.9}, {1, 0.8}, {2, 0.2}, {3, 0.3}};
+            for (auto& job : moving) moved.add_job(job, true);
+            moved.full_realloc();
+            ok &= moved.get_server_count(moving[2]) == 1.0 && moved.get_server_count(moving[3]) == 0.0;
+            moved.update_job_p(moving[2], 0.95, true);
+            std::vector<std::pair<size_t, double>> changes = moved.get_server_changes();
+            std::sort(changes.begin(), changes.end());
+            ok &= changes == std::vector<std::pair<size_t, double>>{{2, 0.0}, {3, 1.0}};
+            ok &= moved.get_server_count(moving[3]) == 1.0 && moved.get_waiting_count() == 1;
+
+            // shrinking a leaf below its admitted jobs sends the ones left without a server back
+            // to the front of the queue, growing it admits them again first
+            RCGREEDY shrunk(4, 0, 1.0, false);
+            shrunk.set_admission(order);
+            RCGREEDY::RCGREEDY_Job queued[6] = {{0, 0.5}, {1, 0.6}, {2, 0.7}, {3, 0.8}, {4, 0.9}, {5, 0.95}};
+            for (auto& job : queued) shrunk.add_job(job, true);
+            shrunk.set_server_count(2);
+            std::vector<std::pair<size_t, double>> requeued;
+            for (const auto& change : shrunk.get_server_changes()) {
+                if (change.second == 0.0) requeued.push_back(change);
+            }
+            std::sort(requeued.begin(), requeued.end());
+            ok &= shrunk.get_waiting_count() == 4 && requeued == std::vector<std::pair<size_t, double>>{{0, 0.0}, {1, 0.0}};
+            ok &= shrunk.get_server_count(queued[2]) == 1.0 && shrunk.get_server_count(queued[3]) == 1.0;
+            shrunk.set_server_count(4);
+            ok &= shrunk.get_waiting_count() == 2;
+            ok &= shrunk.get_server_count(queued[0]) == 1.0 && shrunk.get_server_count(queued[1]) == 1.0;
+        }
+        print_result("RCGREEDY Admission Queues", ok);
+    }
+
+    // ---- Test 18: server assignment only moves what the counts require ----
+    {
+        Server_Assigner assigner(8);
+        bool ok = assigner.apply({{1, 4.0}, {2, 4.0}}).size() == 8 && assigner.free_count() == 0;
+        std::vector<size_t> kept(assigner.get_servers(1).begin(), assigner.get_servers(1).begin() + 2);
+
+        // 3 servers are released and handed straight to the new job
+        const auto& moves = assigner.apply({{1, 2.0}, {2, 3.0}, {3, 3.0}});
+        ok &= moves.size() == 3 && assigner.transfer_count() == 3;
+        for (const auto& move : moves) ok &= move.to == 3 && move.from != Server_Assigner::NO_JOB;
+        ok &= std::vector<size_t>(assigner.get_servers(1)) == kept;
+
+        // every server is held by at most one job
+        std::vector<int> owners(8, 0);
+        for (size_t job : {1, 2, 3}) for (size_t server : assigner.get_servers(job)) owners[server] += 1;
+        ok &= std::count(owners.begin(), owners.end(), 1) == 8;
+
+        // releases to the free pool and takes from it aren't transfers
+        ok &= assigner.remove_job(3).size() == 3 && assigner.free_count() == 3;
+        ok &= assigner.apply({{2, 1.0}}).size() == 2 && assigner.free_count() == 5;
+        ok &= assigner.apply({{4, 4.0}}).size() == 4 && assigner.transfer_count() == 3;
+        ok &= assigner.apply({{4, 4.0}}).empty();
+        print_result("Server Assigner Minimal Moves", ok);
+    }
+
+    // ---- Test 19: updating p matches deleting and re-adding the job ----
+    {
+        std::mt19937 generator(19);
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        RCGREEDY updated(100, 5, 1.0, true), readded(100, 5, 1.0, true);
+        std::vector<RCGREEDY::RCGREEDY_Job> jobs;
+        for (size_t i = 0; i < 60; ++i) {
+            jobs.push_back({i, uniform(generator)});
+            updated.add_job(jobs.back(), true);
+            readded.add_job(jobs.back(), true);
+        }
+
+        bool ok = true;
+        for (size_t i = 0; i < 300; ++i) {
+            RCGREEDY::RCGREEDY_Job& job = jobs[generator() % jobs.size()];
+            // small changes mostly stay in the same leaf, large ones move it
+            double new_p = (i % 2) ? std::clamp(job.p + (uniform(generator) - 0.5) * 0.02, 0.0, 1.0) : uniform(generator);
+            bool forced = i % 3;
+            updated.update_job_p(job, new_p, forced);
+            readded.delete_job(job, false);
+            readded.add_job(job, false);
+
+            // the moved job is reported unless its leaf didn't change
+            bool reported = updated.get_server_changes().empty();
+            for (const auto& change : updated.get_server_changes()) reported |= change.first == job.id;
+            ok &= reported;
+        }
+
+        // with the same jobs and p values, a full reallocation gives the same allocation
+        updated.full_realloc();
+        readded.full_realloc();
+        std::vector<std::pair<size_t, double>> a1, a2;
+        updated.get_all_server_count(a1);
+        readded.get_all_server_count(a2);
+        std::sort(a1.begin(), a1.end());
+        std::sort(a2.begin(), a2.end());
+        ok &= a1.size() == a2.size();
+        for (size_t i = 0; ok && i < a1.size(); ++i) ok &= a1[i].first == a2[i].first && double_eq(a1[i].second, a2[i].second);
+        print_result("RCGREEDY Update Job P", ok);
+    }
+
+    // ---- Test 20: reporting every job only visits occupied leaves, but still finds them all ----
+    {
+        std::mt19937 generator(20);
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        RCGREEDY scheduler(8, 10, 1.0, false);
+        scheduler.set_admission(RCGREEDY::Admission::FCFS);
+        std::vector<RCGREEDY::RCGREEDY_Job> jobs;
+        bool ok = true;
+        for (size_t i = 0; i < 400; ++i) {
+            size_t action = generator() % 3;
+            if (action == 0 || jobs.size() < 4) {
+                jobs.push_back({i, uniform(generator)});
+                scheduler.add_job(jobs.back(), i % 2);
+            } else if (action == 1) {
+                size_t index = generator() % jobs.size();
+                scheduler.delete_job(jobs[index], i % 2);
+                jobs.erase(jobs.begin() + index);
+            } else {
+                scheduler.update_job_p(jobs[generator() % jobs.size()], uniform(generator), i % 2);
+            }
+
+            // every live job is reported once, waiting ones included
+            std::vector<std::pair<size_t, double>> allocs;
+            scheduler.get_all_server_count(allocs);
+            std::vector<size_t> reported, live;
+            for (const auto& alloc : allocs) reported.push_back(alloc.first);
+            for (const auto& job : jobs) live.push_back(job.id);
+            std::sort(reported.begin(), reported.end());
+            std::sort(live.begin(), live.end());
+            ok &= reported == live;
+        }
+        print_result("RCGREEDY Occupied Leaves", ok);
+    }
+
+    // ---- Test 21: a 4-way split matches the best of every possible split ----
+    {
+        const size_t servers = 12;
+        RCGREEDY wide(servers, 2, 1.0, false), binary(servers, 2, 1.0, false);
+        wide.set_fanout(4);
+        std::vector<RCGREEDY::RCGREEDY_Job> jobs = {{0, 0.1}, {1, 0.2}, {2, 0.3}, {3, 0.6}, {4, 0.9}, {5, 0.95}, {6, 0.99}};
+        bool ok = wide.get_fanout() == 4;
+        for (auto& job : jobs) {
+            wide.add_job(job, false);
+            binary.add_job(job, false);
+            ok &= wide.get_job_leaf(job) == binary.get_job_leaf(job);   // same bins with one level
+        }
+        wide.full_realloc();
+
+        // servers of each leaf, from the jobs in it
+        size_t leaf_servers[4] = {0, 0, 0, 0};
+        double leaf_p[4] = {0, 0, 0, 0};
+        double leaf_jobs[4] = {0, 0, 0, 0};
+        for (auto& job : jobs) {
+            size_t leaf = wide.get_job_leaf(job);
+            leaf_servers[leaf] += static_cast<size_t>(wide.get_server_count(job));
+            leaf_p[leaf] += job.p;
+            leaf_jobs[leaf] += 1;
+        }
+        auto objective = [&](const size_t* a) {
+            double value = 0.0;
+            for (size_t i = 0; i < 4; ++i) {
+                if (a[i]) value += leaf_jobs[i] * wide.speedup_factor(leaf_p[i] / leaf_jobs[i], a[i] / leaf_jobs[i]);
+            }
+            return value;
+        };
+
+        double best = 0.0;
+        for (size_t a0 = 0; a0 <= servers; ++a0) {
+            for (size_t a1 = 0; a0 + a1 <= servers; ++a1) {
+                for (size_t a2 = 0; a0 + a1 + a2 <= servers; ++a2) {
+                    size_t a[4] = {a0, a1, a2, servers - a0 - a1 - a2};
+                    best = std::max(best, objective(a));
+                }
+            }
+        }
+        ok &= leaf_servers[0] + leaf_servers[1] + leaf_servers[2] + leaf_servers[3] == servers;
+        ok &= std::abs(objective(leaf_servers) - best) < EPS;
+        print_result("RCGREEDY Fanout", ok, std::to_string(best), std::to_string(objective(leaf_servers)));
+    }
+
+    // ---- Test 22: adaptive bins spread clustered p values over the leaves ----
+    {
+        std::mt19937 generator(22);
+        std::uniform_real_distribution<double> clustered(0.85, 0.99);
+        RCGREEDY even(100, 5, 1.0, false), adaptive(100, 5, 1.0, false);
+        adaptive.set_adaptive_bins(500);
+        std::vector<RCGREEDY::RCGREEDY_Job> jobs;
+        for (size_t i = 0; i < 2000; ++i) {
+            jobs.push_back({i, clustered(generator)});
+            even.add_job(jobs.back(), true);
+            adaptive.add_job(jobs.back(), true);
+        }
+
+        // the rebalance after the last add reports every job, with all the servers
+        std::unordered_map<size_t, double> reported;
+        for (const auto& change : adaptive.get_server_changes()) reported[change.first] = change.second;
+        bool ok = reported.size() == jobs.size();
+        double total = 0.0;
+        for (const auto& job : reported) total += job.second;
+        ok &= double_eq(total, 100.0);
+
+        // with admission queues, a rebalance keeps what the add that triggered it reported,
+        // including the jobs it sent back to their queues
+        for (size_t fanout : {2, 4, 8}) {
+            for (unsigned seed = 0; seed < 20; ++seed) {
+                RCGREEDY queued(4 + seed % 5, 3, 1.0, false);
+                queued.set_fanout(fanout);
+                queued.set_admission(seed % 2 ? RCGREEDY::Admission::FCFS : RCGREEDY::Admission::SMALLEST_P);
+                queued.set_adaptive_bins(5 + seed % 7, 32);
+                ok &= changes_match_allocations(queued, seed, 300);
+            }
+        }
+
+        std::vector<size_t> even_leaves(32, 0), adaptive_leaves(32, 0);
+        for (auto& job : jobs) {
+            even_leaves[even.get_job_leaf(job)] += 1;
+            adaptive_leaves[adaptive.get_job_leaf(job)] += 1;
+        }
+        size_t even_max = *std::max_element(even_leaves.begin(), even_leaves.end());
+        size_t adaptive_max = *std::max_element(adaptive_leaves.begin(), adaptive_leaves.end());
+        ok &= even_max > 300 && adaptive_max < 2 * jobs.size() / 32;
+        print_result("RCGREEDY Adaptive Bins", ok, "< 125", std::to_string(adaptive_max));
+    }
+
+    // ---- Test 23: online depth selection only keeps levels that pay for themselves ----
+    {
+        RCGREEDY same_p(50, 6, 1.0, true), spread(50, 6, 1.0, true), expensive(50, 6, 1.0, true);
+        same_p.set_auto_depth(10, 0.0);
+        spread.set_auto_depth(10, 0.0);
+        expensive.set_auto_depth(10, 1.0);
+        for (size_t i = 0; i < 40; ++i) {
+            RCGREEDY::RCGREEDY_Job job{i, 0.3};
+            same_p.add_job(job, true);
+            job.p = (i % 2) ? 0.05 : 0.95;
+            spread.add_job(job, true);
+            expensive.add_job(job, true);
+        }
+
+        // identical jobs gain nothing from splitting, very expensive splits are never worth it
+        bool ok = same_p.get_effective_depth() == 0 && expensive.get_effective_depth() == 0;
+        ok &= spread.get_effective_depth() >= 1;
+
+        // the merged leaves still hold every job and every server
+        std::vector<std::pair<size_t, double>> allocs;
+        spread.get_all_server_count(allocs);
+        double total = 0.0;
+        for (const auto& alloc : allocs) total += alloc.second;
+        ok &= allocs.size() == 40 && double_eq(total, 50.0);
+
+        // at depth 0 nothing is split, the predictions of later depth checks don't count as work
+        size_t evaluations = expensive.get_split_evaluations();
+        for (size_t i = 40; i < 80; ++i) {
+            RCGREEDY::RCGREEDY_Job job{i, (i % 2) ? 0.05 : 0.95};
+            expensive.add_job(job, true);
+        }
+        ok &= expensive.get_effective_depth() == 0 && expensive.get_split_evaluations() == evaluations;
+
+        // with admission queues, a depth change keeps what the add that triggered it reported,
+        // also when a bin rebalance migrated the jobs on the same add
+        for (size_t fanout : {2, 4, 8}) {
+            for (unsigned seed = 0; seed < 20; ++seed) {
+                RCGREEDY queued(4 + seed % 5, 3, 1.0, false);
+                queued.set_fanout(fanout);
+                queued.set_admission(seed % 2 ? RCGREEDY::Admission::FCFS : RCGREEDY::Admission::SMALLEST_P);
+                queued.set_auto_depth(4 + seed % 3, seed % 4 ? 0.0 : 1e-3);
+                if (seed % 3 == 0) queued.set_adaptive_bins(4 + seed % 3, 32);
+                ok &= changes_match_allocations(queued, 100 + seed, 300);
+            }
+        }
+        print_result("RCGREEDY Auto Depth", ok, "0 0 >=1", std::to_string(same_p.get_effective_depth()) + " "
+                     + std::to_string(expensive.get_effective_depth()) + " " + std::to_string(spread.get_effective_depth()));
+    }
+
+    // ---- Test 24: resizing the pool matches a full reallocation and only reports changed jobs ----
+    {
+        std::mt19937 generator(24);
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        RCGREEDY resized(40, 4, 1.0, false), rebuilt(40, 4, 1.0, false);
+        for (size_t i = 0; i < 30; ++i) {
+            RCGREEDY::RCGREEDY_Job job{i, uniform(generator)};
+            resized.add_job(job, true);
+            rebuilt.add_job(job, true);
+        }
+
+        bool ok = true;
+        for (size_t servers : {60, 60, 25, 3, 100}) {
+            resized.full_realloc();
+            std::vector<std::pair<size_t, double>> before, after, expected;
+            resized.get_all_server_count(before);
+            resized.set_server_count(servers);
+            resized.get_all_server_count(after);
+            rebuilt.set_server_count(servers);
+            rebuilt.full_realloc();
+            rebuilt.get_all_server_count(expected);
+            std::sort(before.begin(), before.end());
+            std::sort(after.begin(), after.end());
+            std::sort(expected.begin(), expected.end());
+            ok &= after == expected && resized.get_server_count() == servers;
+
+            // every changed job is reported, and an unchanged pool reports nothing
+            std::vector<std::pair<size_t, double>> changes = resized.get_server_changes();
+            std::sort(changes.begin(), changes.end());
+            for (size_t i = 0; i < after.size(); ++i) {
+                bool reported = std::binary_search(changes.begin(), changes.end(), after[i]);
+                ok &= before[i].second == after[i].second || reported;
+            }
+            ok &= before != after || changes.empty();
+        }
+
+        // servers left below a group emptied before a resize must not look current to a later add
+        auto conserves = [](RCGREEDY& scheduler, size_t servers) {
+            std::vector<std::pair<size_t, double>> allocs;
+            scheduler.get_all_server_count(allocs);
+            double total = 0.0;
+            for (auto& alloc : allocs) total += alloc.second;
+            return total <= servers + EPS;
+        };
+        RCGREEDY drained(9, 1, 1.0, true);
+        RCGREEDY::RCGREEDY_Job job_4{4, 2979 / 4096.0}, job_6{6, 3645 / 4096.0};
+        drained.add_job(job_4, true);
+        drained.delete_job(job_4, false);
+        drained.set_server_count(8);
+        drained.add_job(job_6, true);
+        ok &= conserves(drained, 8);
+
+        RCGREEDY split(2, 2, 1.0, true);
+        RCGREEDY::RCGREEDY_Job job_10{10, 946 / 4096.0}, job_13{13, 2424 / 4096.0}, job_14{14, 2873 / 4096.0};
+        split.add_job(job_10, true);
+        split.add_job(job_13, false);
+        split.full_realloc();
+        split.delete_job(job_13, false);
+        split.set_server_count(19);
+        split.add_job(job_14, true);
+        ok &= conserves(split, 19);
+
+        EQUI equi(10, true);
+        equi.insert_job(1);
+        equi.set_server_count(4);
+        ok &= double_eq(equi.get_allocation(1), 4.0);
+        print_result("Elastic Server Count", ok);
+    }
+
+    // ---- Test 25: federated pools share the jobs by their servers ----
+    {
+        std::vector<Pool_Stats> pools(3);
+        pools[0] = {10, 30, 0.0};
+        pools[1] = {10, 0, 0.0};
+        pools[2] = {20, 10, 0.0};
+        std::vector<Pool_Transfer> plan = plan_rebalance(pools, 0.1);
+        bool ok = plan.size() == 2 && plan[0].from == 0 && plan[0].to == 1 && plan[0].count == 10
+               && plan[1].from == 0 && plan[1].to == 2 && plan[1].count == 10;
+
+        // routing over every pool fills them by their servers, rebalancing restores it after deletes
+        std::mt19937 generator(25);
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        Federation federation({10, 10, 20}, 3, 1.0, false, 3);
+        for (size_t i = 0; i < 40; ++i) {
+            RCGREEDY::RCGREEDY_Job job{i, uniform(generator)};
+            federation.add_job(job, true);
+        }
+        const auto& stats = federation.get_stats();
+        ok &= stats[0].jobs == 10 && stats[1].jobs == 10 && stats[2].jobs == 20;
+        for (size_t i = 0; i < 40; ++i) {
+            if (federation.get_job_pool(i) != 2) continue;
+            RCGREEDY::RCGREEDY_Job job{i, 0.0};
+            federation.delete_job(job, true);
+        }
+        ok &= federation.rebalance(0.1) == 10 && stats[0].jobs == 5 && stats[1].jobs == 5 && stats[2].jobs == 10;
+        for (size_t pool = 0; pool < federation.get_pool_count(); ++pool) {
+            std::vector<std::pair<size_t, double>> allocs;
+            federation.get_pool(pool).get_all_server_count(allocs);
+            double total = 0.0;
+            for (const auto& alloc : allocs) total += alloc.second;
+            ok &= allocs.size() == stats[pool].jobs && total <= stats[pool].servers + EPS;
+        }
+
+        // a single pool runs exactly like the plain simulator, several still finish every job
+        auto events = generate_events(200, 1.0, 1.0, 25);
+        SimulationOptions options;
+        SimulationResults plain = lockstep_runner(events, {R3}, 20, true)[0];
+        SimulationResults single = federated_runner(events, R3, 20, true, 10, 1.0, options);
+        options.pools = 4;
+        options.rebalance_epoch = 5.0;
+        SimulationResults split = federated_runner(events, R3, 20, true, 10, 1.0, options);
+        ok &= single.avg_processing_time == plain.avg_processing_time && single.migrations == 0;
+        ok &= split.completed_jobs + split.warmup_jobs == 200;
+        print_result("Federation", ok, "", std::to_string(split.migrations) + " migrations");
+    }
+
+    // ---- Test 26: the shared memory ring keeps order across a wrap, the service acknowledges batches, the daemon drops dead and stalled clients ----
+    {
+        std::string name = "/rcgreedy-test-" + std::to_string(getpid());
+        auto consumer = Shm_Ring::create(name, 50);
+        auto producer = Shm_Ring::attach(name);
+        bool ok = consumer && producer && consumer->capacity() == 64;
+
+        // bursts of pushes and pops of random length, so the ring runs full, empty and wraps often
+        std::mt19937 generator(26);
+        std::uniform_int_distribution<size_t> burst(0, 80);
+        uint64_t sent = 0, received = 0;
+        Service_Message message;
+        while (ok && received < 100000) {
+            size_t pushes = burst(generator), pops = burst(generator);
+            for (size_t i = 0; i < pushes; ++i) {
+                message.id = sent;
+                if (!producer->push(message)) {
+                    ok &= sent - received == 64;
+                    break;
+                }
+                sent += 1;
+            }
+            for (size_t i = 0; i < pops && consumer->pop(message); ++i) {
+                ok &= message.id == received;
+                received += 1;
+            }
+        }
+        while (ok && consumer->pop(message)) ok &= message.id == received++;
+        ok &= received == sent;
+
+        // the creator sees the attached end go away
+        ok &= !consumer->peer_gone();
+        producer.reset();
+        ok &= consumer->peer_gone();
+
+        // a query answers what the scheduler holds, and only the last request of a batch is acknowledged
+        Scheduler_Service service(10, 3, true, 0);
+        RCGREEDY reference(10, 3, 1.0, true);
+        std::vector<Service_Message> out;
+        for (uint64_t i = 0; i < 3; ++i) {
+            Service_Message add;
+            add.id = i;
+            add.value = 0.3 * i;
+            add.batch = 7;
+            add.end_of_batch = i == 2;
+            service.handle(add, out);
+            RCGREEDY::RCGREEDY_Job job{i, 0.3 * i};
+            reference.add_job(job, true);
+        }
+        ok &= out.back().type == Service_Message::ACK && out.back().batch == 7;
+        ok &= std::count_if(out.begin(), out.end(), [](const Service_Message& m) { return m.type == Service_Message::ACK; }) == 1;
+
+        out.clear();
+        Service_Message query;
+        query.type = Service_Message::QUERY;
+        query.id = 1;
+        service.handle(query, out);
+        RCGREEDY::RCGREEDY_Job job{1, 0.3};
+        ok &= out.size() == 1 && out[0].type == Service_Message::ALLOCATION && double_eq(out[0].value, reference.get_server_count(job));
+
+        // the daemon drops a client that exits without disconnecting, and one that stops reading
+        for (bool stop_reading : {false, true}) {
+            Service_Options options;
+            options.name = "rcgreedy-test-" + std::to_string(getpid()) + (stop_reading ? "-stalled" : "-exited");
+            options.ring_capacity = 4;
+            options.servers = 10;
+            options.depth = 3;
+            options.client_timeout = 0.2;
+            pid_t client = fork();
+            if (client == 0) {
+                std::unique_ptr<Shm_Ring> requests, responses;
+                while (!requests || !responses) {
+                    if (!requests) requests = Shm_Ring::attach("/" + options.name + "-request-0");
+                    if (!responses) responses = Shm_Ring::attach("/" + options.name + "-response-0");
+                    usleep(1000);
+                }
+                Service_Message query;
+                query.type = Service_Message::QUERY;
+                for (size_t sent = 0; sent < (stop_reading ? 100 : 3); ) {
+                    if (requests->push(query)) sent += 1;
+                    else usleep(1000);
+                }
+                if (stop_reading) pause();
+                _exit(0);
+            }
+
+            std::streambuf* output = std::cout.rdbuf(nullptr);
+            std::streambuf* errors = std::cerr.rdbuf(nullptr);
+            ok &= client > 0 && run_daemon(options) == 0;
+            std::cout.rdbuf(output);
+            std::cerr.rdbuf(errors);
+            if (client > 0) {
+                kill(client, SIGKILL);
+                waitpid(client, nullptr, 0);
+            }
+        }
+        print_result("Shared Memory Ring and Service", ok);
+    }
+
+    // ---- Test 27: a restored scheduler matches the original, and keeps matching as both change ----
+    {
+        // random adds and deletes, the second half runs on both the original and the restored copy
+        std::mt19937 generator(27);
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        std::vector<std::pair<size_t, double>> ops;     // (id, p), p < 0 deletes
+        std::vector<size_t> live;
+        for (size_t id = 0; ops.size() < 400; ) {
+            if (live.empty() || uniform(generator) < 0.65) {
+                ops.push_back({id, uniform(generator)});
+                live.push_back(id++);
+            } else {
+                size_t victim = generator() % live.size();
+                ops.push_back({live[victim], -1.0});
+                live[victim] = live.back();
+                live.pop_back();
+            }
+        }
+        auto apply = [](RCGREEDY &rcg, const std::pair<size_t, double> &op, size_t step) {
+            RCGREEDY::RCGREEDY_Job job{op.first, op.second};
+            if (op.second < 0) {
+                rcg.delete_job(job, true);
+            } else {
+                rcg.add_job(job, true);
+            }
+            if (step % 10 == 0) rcg.realloc_step(3);
+        };
+
+        RCGREEDY original(30, 5, 1.0, false);
+        original.set_fanout(4);
+        original.set_admission(RCGREEDY::Admission::FCFS);
+        original.set_adaptive_bins(20, 64);
+        original.set_adaptive_realloc(0.5);
+        for (size_t i = 0; i < 200; ++i) apply(original, ops[i], i);
+
+        std::string path = "/tmp/rcgreedy-test-" + std::to_string(getpid()) + ".snap";
+        bool ok = original.save_snapshot(path);
+        std::unique_ptr<RCGREEDY> restored = RCGREEDY::load_snapshot(path);
+        std::remove(path.c_str());
+        ok &= restored != nullptr;
+
+        for (size_t i = 200; ok && i < ops.size(); ++i) {
+            apply(original, ops[i], i);
+            apply(*restored, ops[i], i);
+            ok &= original.get_server_changes() == restored->get_server_changes();
+        }
+        if (ok) {
+            std::vector<std::pair<size_t, double>> expected, actual;
+            original.get_all_server_count(expected);
+            restored->get_all_server_count(actual);
+            ok &= expected == actual && original.get_waiting_count() == restored->get_waiting_count();
+        }
+
+        // EQUI hands its whole server remainders out in set order, which has to survive too
+        EQUI equi(20, false);
+        for (size_t i = 0; i < 7; ++i) equi.insert_job(generator() % 1000);
+        std::vector<char> image;
+        equi.snapshot(image);
+        std::unique_ptr<EQUI> equi_restored = EQUI::restore(image.data(), image.size());
+        std::vector<std::pair<size_t, double>> expected, actual;
+        equi.get_all_allocations(expected);
+        if (equi_restored) equi_restored->get_all_allocations(actual);
+        ok &= equi_restored && expected == actual;
+
+        // a truncated image is refused
+        image.clear();
+        original.snapshot(image);
+        ok &= RCGREEDY::restore(image.data(), image.size() / 2) == nullptr;
+
+        // a corrupt byte anywhere is either refused or restores to a scheduler whose lists can be
+        // walked (out of bounds reads are caught when built with the sanitizers)
+        std::streambuf* errors = std::cerr.rdbuf(nullptr);
+        size_t refused = 0;
+        for (size_t i = 0; i < image.size(); ++i) {
+            std::vector<char> corrupt = image;
+            corrupt[i] = static_cast<char>(~corrupt[i]);
+            std::unique_ptr<RCGREEDY> corrupt_restored = RCGREEDY::restore(corrupt.data(), corrupt.size());
+            if (!corrupt_restored) {
+                refused += 1;
+                continue;
+            }
+            std::vector<std::pair<size_t, double>> allocs;
+            corrupt_restored->get_all_server_count(allocs);
+        }
+        std::cerr.rdbuf(errors);
+        std::cerr.clear();
+        ok &= refused > 0;
+        print_result("Snapshot Round Trip", ok);
+    }
+
+    // ---- Test 28: a pipelined run gives the single threaded results ----
+    {
+        // small queues make every stage wait on its neighbours
+        SimulationOptions options;
+        options.pipeline_capacity = 4;
+        options.warmup_jobs = 20;
+        options.batch_count = 5;
+        std::vector<int> schedulers = {E, R2, R4};
+        auto events = generate_events(500, 1.0, 0.2, 28, 0.1, 0.9);
+        std::vector<SimulationResults> expected = lockstep_runner(events, schedulers, 12, false, 10, 0.2, options);
+        std::vector<SimulationResults> actual = pipelined_runner(500, 1.0, 0.2, 28, 0.1, 0.9, schedulers, 12,
+                                                                 false, 10, options);
+
+        bool ok = expected.size() == actual.size();
+        for (size_t i = 0; ok && i < expected.size(); ++i) {
+            ok &= expected[i].avg_processing_time == actual[i].avg_processing_time &&
+                  expected[i].completed_jobs == actual[i].completed_jobs &&
+                  expected[i].ci_half_width == actual[i].ci_half_width &&
+                  expected[i].effective_depth == actual[i].effective_depth &&
+                  actual[i].wall_time > 0;
+        }
+        print_result("Pipelined Simulation", ok);
+    }
+
+    // ---- Test 29: the calendar queue pops like the heap, and simulates the same ----
+    {
+        // clustered and far apart times, growth and shrinkage through resizes, and pushes
+        // before the last popped time as stale simulator events cause
+        std::unique_ptr<Event_Set> heap = make_event_set(Event_Set_Kind::HEAP);
+        std::unique_ptr<Event_Set> calendar = make_event_set(Event_Set_Kind::CALENDAR);
+        std::mt19937 generator(29);
+        std::exponential_distribution<double> spacing(1.0);
+        long double now = 0.0;
+        bool ok = true;
+        for (size_t step = 0; ok && step < 20000; ++step) {
+            bool grow = (step / 2000) % 2 == 0;
+            if (heap->empty() || generator() % 100 < (grow ? 60u : 35u)) {
+                long double time = now + (generator() % 10 == 0 ? 1000 * spacing(generator) : 0.01 * spacing(generator));
+                if (generator() % 20 == 0) time = now - spacing(generator);
+                Event event{COMPLETION, std::max<long double>(time, 0.0), Job{}};
+                heap->push(event);
+                calendar->push(event);
+            } else {
+                ok &= calendar->top().event_time == heap->top().event_time;
+                now = heap->top().event_time;
+                heap->pop();
+                calendar->pop();
+            }
+            ok &= calendar->size() == heap->size();
+        }
+
+        auto events = generate_events(600, 1.0, 0.5, 29);
+        SimulationOptions options;
+        options.event_set = Event_Set_Kind::CALENDAR;
+        std::vector<SimulationResults> expected = lockstep_runner(events, {E, R3}, 10, true, 10, 0.5);
+        std::vector<SimulationResults> actual = lockstep_runner(events, {E, R3}, 10, true, 10, 0.5, options);
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ok &= expected[i].avg_processing_time == actual[i].avg_processing_time;
+        }
+        print_result("Calendar Event Set", ok);
+    }
+
+    // ---- Test 30: RCGREEDY matches the reference model, and failing cases shrink ----
+    {
+        Fuzz_Options options;
+        options.max_cases = 300;
+        options.max_ops = 150;
+        options.seed = 30;
+        bool ok = true;
+        for (size_t i = 0; ok && i < options.max_cases; ++i) {
+            std::mt19937 generator(options.seed + i);
+            ok &= run_fuzz_case(random_fuzz_case(generator, options.max_ops)).empty();
+        }
+
+        // a stand in failure needing an add of job 7 followed later by a full reallocation
+        std::mt19937 generator(30);
+        Fuzz_Case fuzz_case = random_fuzz_case(generator, 200);
+        fuzz_case.ops.insert(fuzz_case.ops.begin() + fuzz_case.ops.size() / 3, Fuzz_Op{Fuzz_Op::ADD, 7, 0.5, false, 0});
+        fuzz_case.ops.push_back(Fuzz_Op{Fuzz_Op::FULL_REALLOC, 0, 0.0, false, 0});
+        auto fails = [](const Fuzz_Case &candidate) {
+            bool added = false;
+            for (const Fuzz_Op &op : candidate.ops) {
+                if (op.type == Fuzz_Op::ADD && op.id == 7) added = true;
+                if (op.type == Fuzz_Op::FULL_REALLOC && added) return true;
+            }
+            return false;
+        };
+        Fuzz_Case shrunk = shrink_fuzz_case(fuzz_case, fails);
+        ok &= shrunk.ops.size() == 2 && shrunk.servers == 1 && shrunk.depth == 0;
+        print_result("Differential Fuzzing", ok);
+    }
+
+    // ---- Test 31: the simulator keeps exactly one live completion event per group with jobs ----
+    {
+        auto event_queue = generate_events(800, 1.0, 0.2, 31);
+        std::vector<Event> arrivals;
+        while (!event_queue.empty()) {
+            arrivals.push_back(event_queue.top());
+            event_queue.pop();
+        }
+
+        SimulationOptions queued, estimated;
+        queued.admission = RCGREEDY::Admission::FCFS;
+        estimated.estimate_p = true;
+        std::vector<std::unique_ptr<Scheduler_Sim>> sims;
+        sims.push_back(std::make_unique<Scheduler_Sim>(arrivals, E, 20, true, 0, 10, 0.2));
+        sims.push_back(std::make_unique<Scheduler_Sim>(arrivals, R3, 20, true, 3, 10, 0.2));
+        sims.push_back(std::make_unique<Scheduler_Sim>(arrivals, R3, 20, false, 3, 10, 0.2, queued));
+        sims.push_back(std::make_unique<Scheduler_Sim>(arrivals, R4, 20, true, 4, 10, 0.2, estimated));
+
+        // checked after every arrival and completion
+        bool ok = true;
+        auto one_per_group = [](Scheduler_Sim& sim) {
+            std::set<size_t> busy;
+            for (const auto& job : sim.jobs()) {
+                if (job.second.group != NO_GROUP) busy.insert(job.second.group);   // not yet admitted
+            }
+            return sim.live_completion_events() == busy.size();
+        };
+        for (auto& sim : sims) {
+            for (size_t i = 0; ok && i < arrivals.size(); ++i) {
+                while (ok && sim->next_completion() < arrivals[i].event_time) {
+                    sim->complete();
+                    ok &= one_per_group(*sim);
+                }
+                sim->arrive(i);
+                ok &= one_per_group(*sim);
+            }
+            while (ok && sim->next_completion() < std::numeric_limits<long double>::infinity()) {
+                sim->complete();
+                ok &= one_per_group(*sim);
+            }
+            ok &= sim->jobs().empty();
+        }
+        print_result("One Completion Event Per Group", ok);
+    }
+
     return 0;
 }
\ No newline at end of file
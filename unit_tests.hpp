@@ -3,6 +3,10 @@
 
 #include "rcgreedy_base.hpp"
 #include "equi.hpp"
+#include "simulator.hpp"
+#include "federation.hpp"
+#include "scheduler_service.hpp"
+#include "differential_fuzz.hpp"
 #include "gtest/gtest.h"
 
 const double EPS = 1e-6;